@@ -6,8 +6,15 @@
  */
 
 #include <ctype.h>
+#include <pthread.h>
+#include <vdr/thread.h>
 #include <vdr/tools.h>
 #include "common.h"
+#include "config.h"
+#include "log.h"
+
+static cMutex threadSchedulingMutexS;
+static cString threadSchedulingS[SATIP_THREAD_CLASS_COUNT];
 
 uint16_t ts_pid(const uint8_t *bufP)
 {
@@ -77,6 +84,301 @@ cString ChangeCase(const cString &strP, bool upperP)
   return res;
 }
 
+cSatipHeader::cSatipHeader(const char *dataP, size_t lengthP)
+: dataM(dataP ? dataP : ""),
+  endM(dataM + (dataP ? lengthP : 0)),
+  nextM(dataM),
+  lineM(NULL),
+  lineLengthM(0),
+  valueM(NULL),
+  valueLengthM(0),
+  nameLengthM(0)
+{
+}
+
+bool cSatipHeader::Next(void)
+{
+  while (nextM < endM) {
+        const char *p = nextM;
+        const char *eol = (const char *)memchr(p, '\n', endM - p);
+        const char *e = eol ? eol : endM;
+        nextM = eol ? eol + 1 : endM;
+        while ((p < e) && ((*p == ' ') || (*p == '\t')))
+              ++p;
+        while ((e > p) && ((e[-1] == '\r') || (e[-1] == ' ') || (e[-1] == '\t')))
+              --e;
+        // Skip empty lines and stop at a terminating NUL
+        if (p == e)
+           continue;
+        if (!*p)
+           break;
+        lineM = p;
+        lineLengthM = e - p;
+        const char *colon = (const char *)memchr(p, ':', e - p);
+        if (colon) {
+           nameLengthM = colon - p;
+           while ((nameLengthM > 0) && (p[nameLengthM - 1] == ' '))
+                 --nameLengthM;
+           valueM = colon + 1;
+           while ((valueM < e) && ((*valueM == ' ') || (*valueM == '\t')))
+                 ++valueM;
+           valueLengthM = e - valueM;
+           }
+        else {
+           nameLengthM = 0;
+           valueM = e;
+           valueLengthM = 0;
+           }
+        return true;
+        }
+  lineM = valueM = NULL;
+  lineLengthM = valueLengthM = nameLengthM = 0;
+
+  return false;
+}
+
+bool cSatipHeader::Is(const char *nameP) const
+{
+  size_t len = strlen(nameP);
+  return (lineM && (nameLengthM == len) && !strncasecmp(lineM, nameP, len));
+}
+
+bool cSatipHeader::Find(const char *nameP)
+{
+  Rewind();
+  while (Next()) {
+        if (Is(nameP))
+           return true;
+        }
+
+  return false;
+}
+
+int cSatipHeader::IntValue(int defaultP) const
+{
+  if (valueM && valueLengthM && (isdigit(*valueM) || (*valueM == '-')))
+     return (int)strtol(valueM, NULL, 10);
+
+  return defaultP;
+}
+
+size_t cSatipHeader::CopyValue(char *dstP, size_t sizeP, char delimP) const
+{
+  size_t len = valueLengthM;
+  if (delimP && valueM) {
+     const char *d = (const char *)memchr(valueM, delimP, valueLengthM);
+     if (d)
+        len = d - valueM;
+     }
+
+  return Copy(dstP, sizeP, valueM, len);
+}
+
+const char *cSatipHeader::Parameter(const char *valueP, size_t lengthP, const char *keyP, size_t *paramLengthP)
+{
+  size_t keyLength = strlen(keyP);
+  const char *p = valueP;
+  const char *end = valueP + lengthP;
+
+  while (p < end) {
+        const char *sep = (const char *)memchr(p, ';', end - p);
+        const char *next = sep ? sep : end;
+        if (((size_t)(next - p) > keyLength) && (p[keyLength] == '=') && !strncasecmp(p, keyP, keyLength)) {
+           if (paramLengthP)
+              *paramLengthP = next - p - keyLength - 1;
+           return p + keyLength + 1;
+           }
+        p = sep ? sep + 1 : end;
+        }
+
+  return NULL;
+}
+
+bool cSatipHeader::HasToken(const char *valueP, size_t lengthP, const char *tokenP)
+{
+  size_t tokenLength = strlen(tokenP);
+  const char *p = valueP;
+  const char *end = valueP + lengthP;
+
+  while (p < end) {
+        const char *sep = (const char *)memchr(p, ';', end - p);
+        const char *next = sep ? sep : end;
+        if (((size_t)(next - p) == tokenLength) && !strncasecmp(p, tokenP, tokenLength))
+           return true;
+        p = sep ? sep + 1 : end;
+        }
+
+  return false;
+}
+
+size_t cSatipHeader::Copy(char *dstP, size_t sizeP, const char *srcP, size_t lengthP)
+{
+  if (!dstP || !sizeP)
+     return 0;
+  if (!srcP)
+     lengthP = 0;
+  if (lengthP >= sizeP)
+     lengthP = sizeP - 1;
+  if (lengthP)
+     memcpy(dstP, srcP, lengthP);
+  dstP[lengthP] = 0;
+
+  return lengthP;
+}
+
+bool cSatipSessionHeader::Parse(const char *valueP, size_t lengthP)
+{
+  const char *sep = (const char *)memchr(valueP, ';', lengthP);
+  size_t len;
+  const char *timeout = cSatipHeader::Parameter(valueP, lengthP, "timeout", &len);
+
+  cSatipHeader::Copy(idM, sizeof(idM), valueP, sep ? (size_t)(sep - valueP) : lengthP);
+  timeoutM = (timeout && len) ? atoi(timeout) : -1;
+
+  return !!*idM;
+}
+
+bool cSatipTransportHeader::Parse(const char *valueP, size_t lengthP)
+{
+  const char *param;
+  size_t len;
+
+  modeM = eModeUnknown;
+  rtpM = rtcpM = ttlM = -1;
+  destinationM[0] = sourceM[0] = 0;
+  if ((param = cSatipHeader::Parameter(valueP, lengthP, "interleaved", &len)) != NULL) {
+     if (sscanf(param, "%11d-%11d", &rtpM, &rtcpM) == 2)
+        modeM = eModeInterleaved;
+     }
+  else if (cSatipHeader::HasToken(valueP, lengthP, "multicast")) {
+     if ((param = cSatipHeader::Parameter(valueP, lengthP, "destination", &len)) != NULL)
+        cSatipHeader::Copy(destinationM, sizeof(destinationM), param, len);
+     if ((param = cSatipHeader::Parameter(valueP, lengthP, "source", &len)) != NULL)
+        cSatipHeader::Copy(sourceM, sizeof(sourceM), param, len);
+     if ((param = cSatipHeader::Parameter(valueP, lengthP, "ttl", &len)) != NULL)
+        ttlM = atoi(param);
+     if (*destinationM && ((param = cSatipHeader::Parameter(valueP, lengthP, "port", &len)) != NULL) && (sscanf(param, "%11d-%11d", &rtpM, &rtcpM) == 2))
+        modeM = eModeMulticast;
+     }
+  else if ((param = cSatipHeader::Parameter(valueP, lengthP, "client_port", &len)) != NULL) {
+     if (sscanf(param, "%11d-%11d", &rtpM, &rtcpM) == 2)
+        modeM = eModeUnicast;
+     }
+
+  return (modeM != eModeUnknown);
+}
+
+bool ParseCpuList(const char *strP, cpu_set_t *setP)
+{
+  CPU_ZERO(setP);
+  if (isempty(strP))
+     return false;
+  char *s, *p = strdup(strP);
+  char *r = strtok_r(p, ",", &s);
+  bool valid = !!r;
+  while (r && valid) {
+        char *e;
+        long first = strtol(r, &e, 10);
+        long last = first;
+        if (*e == '-')
+           last = strtol(e + 1, &e, 10);
+        if ((e == r) || *e || (first < 0) || (last < first) || (last >= CPU_SETSIZE))
+           valid = false;
+        else {
+           for (long i = first; i <= last; ++i)
+               CPU_SET(i, setP);
+           }
+        r = strtok_r(NULL, ",", &s);
+        }
+  FREE_POINTER(p);
+  if (!valid)
+     CPU_ZERO(setP);
+  return valid;
+}
+
+static cString CpuListToString(const cpu_set_t *setP)
+{
+  cString list = "";
+  for (int i = 0; i < CPU_SETSIZE; ++i) {
+      if (CPU_ISSET(i, setP)) {
+         int j = i;
+         while ((j + 1 < CPU_SETSIZE) && CPU_ISSET(j + 1, setP))
+               ++j;
+         if (j > i)
+            list = cString::sprintf("%s%d-%d,", *list, i, j);
+         else
+            list = cString::sprintf("%s%d,", *list, i);
+         i = j;
+         }
+      }
+  return isempty(*list) ? list : list.Truncate(-1);
+}
+
+void SetThreadScheduling(unsigned int classP)
+{
+  if (classP >= SATIP_THREAD_CLASS_COUNT)
+     return;
+  pthread_t thread = pthread_self();
+  const char *cpus = SatipConfig.GetThreadCpus(classP);
+  if (!isempty(cpus)) {
+     cpu_set_t set;
+     if (!ParseCpuList(cpus, &set)) {
+        error("Invalid CPU list '%s' for %s threads", cpus, thread_class_table[classP]);
+        }
+     else if (int err = pthread_setaffinity_np(thread, sizeof(set), &set)) {
+        error("Unable to set CPU affinity '%s' for %s thread: %s", cpus, thread_class_table[classP], strerror(err));
+        }
+     }
+  if (SatipConfig.GetThreadPolicy(classP) != cSatipConfig::eThreadPolicyOther) {
+     int policy = (SatipConfig.GetThreadPolicy(classP) == cSatipConfig::eThreadPolicyFifo) ? SCHED_FIFO : SCHED_RR;
+     struct sched_param param;
+     memset(&param, 0, sizeof(param));
+     param.sched_priority = constrain((int)SatipConfig.GetThreadPriority(classP), sched_get_priority_min(policy), sched_get_priority_max(policy));
+     if (int err = pthread_setschedparam(thread, policy, &param))
+        error("Unable to set %s/%d scheduling for %s thread: %s", thread_policy_table[SatipConfig.GetThreadPolicy(classP)], param.sched_priority, thread_class_table[classP], strerror(err));
+     }
+
+  // Record what the kernel actually granted us
+  cString info;
+  cpu_set_t set;
+  int policy;
+  struct sched_param param;
+  CPU_ZERO(&set);
+  memset(&param, 0, sizeof(param));
+  pthread_getaffinity_np(thread, sizeof(set), &set);
+  if (pthread_getschedparam(thread, &policy, &param) == 0 && ((policy == SCHED_FIFO) || (policy == SCHED_RR)))
+     info = cString::sprintf("cpus=%s %s/%d", *CpuListToString(&set), (policy == SCHED_FIFO) ? "fifo" : "rr", param.sched_priority);
+  else
+     info = cString::sprintf("cpus=%s other", *CpuListToString(&set));
+  dbg_funcname("%s (%s) %s", __PRETTY_FUNCTION__, thread_class_table[classP], *info);
+  cMutexLock MutexLock(&threadSchedulingMutexS);
+  threadSchedulingS[classP] = info;
+}
+
+cString GetThreadScheduling(void)
+{
+  cMutexLock MutexLock(&threadSchedulingMutexS);
+  cString info = "";
+  for (unsigned int i = 0; i < SATIP_THREAD_CLASS_COUNT; ++i)
+      info = cString::sprintf("%s%s%s: %s", *info, i ? ", " : "", thread_class_table[i], isempty(*threadSchedulingS[i]) ? "---" : *threadSchedulingS[i]);
+  return info;
+}
+
+const char *const thread_class_table[SATIP_THREAD_CLASS_COUNT] =
+{
+  "poller",   // SATIP_THREAD_POLLER
+  "tuner",    // SATIP_THREAD_TUNER
+  "section",  // SATIP_THREAD_SECTION
+  "discover", // SATIP_THREAD_DISCOVER
+};
+
+const char *const thread_policy_table[cSatipConfig::eThreadPolicyCount] =
+{
+  "other", // eThreadPolicyOther
+  "fifo",  // eThreadPolicyFifo
+  "rr",    // eThreadPolicyRr
+};
+
 const section_filter_table_type section_filter_table[SECTION_FILTER_TABLE_SIZE] =
 {
   // description                        tag    pid   tid   mask
@@ -8,6 +8,7 @@
 #ifndef __SATIP_COMMON_H
 #define __SATIP_COMMON_H
 
+#include <sched.h>
 #include <vdr/device.h>
 #include <vdr/tools.h>
 #include <vdr/config.h>
@@ -27,6 +28,9 @@
 
 #define SATIP_BUFFER_SIZE                KILOBYTE(2048)
 
+#define SATIP_MAX_PIDS                   8192
+#define SATIP_MAX_PID_LIST_LENGTH        (SATIP_MAX_PIDS * 5) // "8191," at most per pid
+
 #define SATIP_DEVICE_INFO_ALL            0
 #define SATIP_DEVICE_INFO_GENERAL        1
 #define SATIP_DEVICE_INFO_PIDS           2
@@ -43,6 +47,13 @@
 #define MAX_CICAM_COUNT                  2
 #define CA_SYSTEMS_TABLE_SIZE            47
 
+#define SATIP_THREAD_POLLER              0
+#define SATIP_THREAD_TUNER               1
+#define SATIP_THREAD_SECTION             2
+#define SATIP_THREAD_DISCOVER            3
+#define SATIP_THREAD_CLASS_COUNT         4
+#define SATIP_THREAD_CPUS_LENGTH         64
+
 #define SATIP_CURL_EASY_GETINFO(X, Y, Z) \
   if ((res = curl_easy_getinfo((X), (Y), (Z))) != CURLE_OK) { \
      esyslog("curl_easy_getinfo(%s) [%s,%d] failed: %s (%d)", #Y,  __FILE__, __LINE__, curl_easy_strerror(res), res); \
@@ -140,12 +151,84 @@ public:
   void Reset(void) { FREE_POINTER(dataM); sizeM = 0; };
 };
 
+// Zero-copy tokenizer for CRLF separated "Name: value" blocks of RTSP and
+// HTTP responses; the buffer is neither copied nor modified.
+class cSatipHeader {
+private:
+  const char *dataM;
+  const char *endM;
+  const char *nextM;
+  const char *lineM;
+  size_t lineLengthM;
+  const char *valueM;
+  size_t valueLengthM;
+  size_t nameLengthM;
+
+public:
+  cSatipHeader(const char *dataP, size_t lengthP);
+  void Rewind(void) { nextM = dataM; lineM = valueM = NULL; lineLengthM = valueLengthM = nameLengthM = 0; }
+  bool Next(void);
+  const char *Line(void) const { return lineM; }
+  size_t LineLength(void) const { return lineLengthM; }
+  const char *Value(void) const { return valueM; }
+  size_t ValueLength(void) const { return valueLengthM; }
+  bool Is(const char *nameP) const;
+  bool Find(const char *nameP);
+  int IntValue(int defaultP) const;
+  size_t CopyValue(char *dstP, size_t sizeP, char delimP = 0) const;
+  static const char *Parameter(const char *valueP, size_t lengthP, const char *keyP, size_t *paramLengthP);
+  static bool HasToken(const char *valueP, size_t lengthP, const char *tokenP);
+  static size_t Copy(char *dstP, size_t sizeP, const char *srcP, size_t lengthP);
+};
+
+// Session: <id>[;timeout=<seconds>]
+class cSatipSessionHeader {
+private:
+  enum { eIdLength = 64 };
+  char idM[eIdLength];
+  int timeoutM;
+
+public:
+  cSatipSessionHeader() : timeoutM(-1) { idM[0] = 0; }
+  bool Parse(const char *valueP, size_t lengthP);
+  const char *Id(void) const { return idM; }
+  int Timeout(void) const { return timeoutM; }
+};
+
+// Transport: RTP/AVP[/TCP];unicast;client_port=..|multicast;destination=..;port=..|interleaved=..
+class cSatipTransportHeader {
+public:
+  enum eMode { eModeUnknown, eModeUnicast, eModeMulticast, eModeInterleaved };
+
+private:
+  enum { eAddressLength = 64 };
+  eMode modeM;
+  int rtpM;
+  int rtcpM;
+  int ttlM;
+  char destinationM[eAddressLength];
+  char sourceM[eAddressLength];
+
+public:
+  cSatipTransportHeader() : modeM(eModeUnknown), rtpM(-1), rtcpM(-1), ttlM(-1) { destinationM[0] = sourceM[0] = 0; }
+  bool Parse(const char *valueP, size_t lengthP);
+  eMode Mode(void) const { return modeM; }
+  int Rtp(void) const { return rtpM; }
+  int Rtcp(void) const { return rtcpM; }
+  int Ttl(void) const { return ttlM; }
+  const char *Destination(void) const { return *destinationM ? destinationM : NULL; }
+  const char *Source(void) const { return *sourceM ? sourceM : NULL; }
+};
+
 uint16_t ts_pid(const uint8_t *bufP);
 uint8_t payload(const uint8_t *bufP);
 const char *id_pid(const u_short pidP);
 char *StripTags(char *strP);
 char *SkipZeroes(const char *strP);
 cString ChangeCase(const cString &strP, bool upperP);
+bool ParseCpuList(const char *strP, cpu_set_t *setP);
+void SetThreadScheduling(unsigned int classP);
+cString GetThreadScheduling(void);
 
 struct section_filter_table_type {
   const char *description;
@@ -166,6 +249,9 @@ struct ca_systems_table_type {
 extern const ca_systems_table_type ca_systems_table[CA_SYSTEMS_TABLE_SIZE];
 extern bool checkCASystem(unsigned int cicamP, int caidP);
 
+extern const char *const thread_class_table[SATIP_THREAD_CLASS_COUNT];
+extern const char *const thread_policy_table[];
+
 extern const char VERSION[];
 
 #endif // __SATIP_COMMON_H
@@ -16,11 +16,17 @@ cSatipConfig::cSatipConfig(void)
   debugModeM(DbgNormal),
   ciExtensionM(0),
   frontendReuseM(1),
+  preTuningM(0),
+  serverSelectionM(eServerSelectionLeastLoaded),
   eitScanM(1),
   useBytesM(1),
   portRangeStartM(0),
   portRangeStopM(0),
   transportModeM(eTransportModeUnicast),
+  pidUpdateWindowM(50),
+  pidLimitM(0),
+  msearchCountM(2),
+  msearchMxM(2),
   detachedModeM(false),
   disableServerQuirksM(false),
   useSingleModelServersM(false),
@@ -32,6 +38,11 @@ cSatipConfig::cSatipConfig(void)
       disabledSourcesM[i] = cSource::stNone;
   for (unsigned int i = 0; i < ELEMENTS(disabledFiltersM); ++i)
       disabledFiltersM[i] = -1;
+  for (unsigned int i = 0; i < SATIP_THREAD_CLASS_COUNT; ++i) {
+      threadCpusM[i][0] = 0;
+      threadPolicyM[i] = eThreadPolicyOther;
+      threadPriorityM[i] = 1;
+      }
 }
 
 int cSatipConfig::GetCICAM(unsigned int indexP) const
@@ -82,3 +93,36 @@ void cSatipConfig::SetDisabledFilters(unsigned int indexP, int numberP)
   if (indexP < ELEMENTS(disabledFiltersM))
      disabledFiltersM[indexP] = numberP;
 }
+
+const char *cSatipConfig::GetThreadCpus(unsigned int classP) const
+{
+  return (classP < SATIP_THREAD_CLASS_COUNT) ? threadCpusM[classP] : "";
+}
+
+void cSatipConfig::SetThreadCpus(unsigned int classP, const char *cpusP)
+{
+  if (classP < SATIP_THREAD_CLASS_COUNT)
+     strn0cpy(threadCpusM[classP], cpusP ? cpusP : "", sizeof(threadCpusM[classP]));
+}
+
+unsigned int cSatipConfig::GetThreadPolicy(unsigned int classP) const
+{
+  return (classP < SATIP_THREAD_CLASS_COUNT) ? threadPolicyM[classP] : eThreadPolicyOther;
+}
+
+void cSatipConfig::SetThreadPolicy(unsigned int classP, unsigned int policyP)
+{
+  if ((classP < SATIP_THREAD_CLASS_COUNT) && (policyP < eThreadPolicyCount))
+     threadPolicyM[classP] = policyP;
+}
+
+unsigned int cSatipConfig::GetThreadPriority(unsigned int classP) const
+{
+  return (classP < SATIP_THREAD_CLASS_COUNT) ? threadPriorityM[classP] : 1;
+}
+
+void cSatipConfig::SetThreadPriority(unsigned int classP, unsigned int priorityP)
+{
+  if (classP < SATIP_THREAD_CLASS_COUNT)
+     threadPriorityM[classP] = constrain(priorityP, 1U, 99U);
+}
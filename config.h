@@ -18,11 +18,17 @@ private:
   unsigned int debugModeM;
   unsigned int ciExtensionM;
   unsigned int frontendReuseM;
+  unsigned int preTuningM;
+  unsigned int serverSelectionM;
   unsigned int eitScanM;
   unsigned int useBytesM;
   unsigned int portRangeStartM;
   unsigned int portRangeStopM;
   unsigned int transportModeM;
+  unsigned int pidUpdateWindowM;
+  unsigned int pidLimitM;
+  unsigned int msearchCountM;
+  unsigned int msearchMxM;
   bool detachedModeM;
   bool disableServerQuirksM;
   bool useSingleModelServersM;
@@ -30,6 +36,9 @@ private:
   int disabledSourcesM[MAX_DISABLED_SOURCES_COUNT];
   int disabledFiltersM[SECTION_FILTER_TABLE_SIZE];
   size_t rtpRcvBufSizeM;
+  char threadCpusM[SATIP_THREAD_CLASS_COUNT][SATIP_THREAD_CPUS_LENGTH];
+  unsigned int threadPolicyM[SATIP_THREAD_CLASS_COUNT];
+  unsigned int threadPriorityM[SATIP_THREAD_CLASS_COUNT];
 
 public:
   enum eOperatingMode {
@@ -45,6 +54,17 @@ public:
     eTransportModeRtpOverTcp,
     eTransportModeCount
   };
+  enum eServerSelection {
+    eServerSelectionFirst = 0,
+    eServerSelectionLeastLoaded,
+    eServerSelectionCount
+  };
+  enum eThreadPolicy {
+    eThreadPolicyOther = 0,
+    eThreadPolicyFifo,
+    eThreadPolicyRr,
+    eThreadPolicyCount
+  };
   enum eDebugMode {
     DbgNormal            = 0,
     DbgCallStack         = (1U << 0),
@@ -77,6 +97,8 @@ public:
   bool IsDebugMode(eDebugMode modeP) const { return (debugModeM & modeP); }
   unsigned int GetCIExtension(void) const { return ciExtensionM; }
   unsigned int GetFrontendReuse(void) const { return frontendReuseM; }
+  unsigned int GetPreTuning(void) const { return preTuningM; }
+  unsigned int GetServerSelection(void) const { return serverSelectionM; }
   int GetCICAM(unsigned int indexP) const;
   unsigned int GetEITScan(void) const { return eitScanM; }
   unsigned int GetUseBytes(void) const { return useBytesM; }
@@ -84,6 +106,10 @@ public:
   bool IsTransportModeUnicast(void) const { return (transportModeM == eTransportModeUnicast); }
   bool IsTransportModeRtpOverTcp(void) const { return (transportModeM == eTransportModeRtpOverTcp); }
   bool IsTransportModeMulticast(void) const { return (transportModeM == eTransportModeMulticast); }
+  unsigned int GetPidUpdateWindow(void) const { return pidUpdateWindowM; }
+  unsigned int GetPidLimit(void) const { return pidLimitM; }
+  unsigned int GetMsearchCount(void) const { return msearchCountM; }
+  unsigned int GetMsearchMx(void) const { return msearchMxM; }
   bool GetDetachedMode(void) const { return detachedModeM; }
   bool GetDisableServerQuirks(void) const { return disableServerQuirksM; }
   bool GetUseSingleModelServers(void) const { return useSingleModelServersM; }
@@ -94,15 +120,24 @@ public:
   unsigned int GetPortRangeStart(void) const { return portRangeStartM; }
   unsigned int GetPortRangeStop(void) const { return portRangeStopM; }
   size_t GetRtpRcvBufSize(void) const { return rtpRcvBufSizeM; }
+  const char *GetThreadCpus(unsigned int classP) const;
+  unsigned int GetThreadPolicy(unsigned int classP) const;
+  unsigned int GetThreadPriority(unsigned int classP) const;
 
   void SetOperatingMode(unsigned int operatingModeP) { operatingModeM = operatingModeP; }
   void SetDebugMode(unsigned int modeP) { debugModeM = (modeP & DbgModeMask); }
   void SetCIExtension(unsigned int onOffP) { ciExtensionM = onOffP; }
   void SetFrontendReuse(unsigned int onOffP) { frontendReuseM = onOffP; }
+  void SetPreTuning(unsigned int onOffP) { preTuningM = onOffP; }
+  void SetServerSelection(unsigned int selectionP) { serverSelectionM = selectionP; }
   void SetCICAM(unsigned int indexP, int cicamP);
   void SetEITScan(unsigned int onOffP) { eitScanM = onOffP; }
   void SetUseBytes(unsigned int onOffP) { useBytesM = onOffP; }
   void SetTransportMode(unsigned int transportModeP) { transportModeM = transportModeP; }
+  void SetPidUpdateWindow(unsigned int msP) { pidUpdateWindowM = msP; }
+  void SetPidLimit(unsigned int pidsP) { pidLimitM = pidsP; }
+  void SetMsearchCount(unsigned int countP) { msearchCountM = countP; }
+  void SetMsearchMx(unsigned int secondsP) { msearchMxM = secondsP; }
   void SetDetachedMode(bool onOffP) { detachedModeM = onOffP; }
   void SetDisableServerQuirks(bool onOffP) { disableServerQuirksM = onOffP; }
   void SetUseSingleModelServers(bool onOffP) { useSingleModelServersM = onOffP; }
@@ -111,6 +146,9 @@ public:
   void SetPortRangeStart(unsigned int rangeStartP) { portRangeStartM = rangeStartP; }
   void SetPortRangeStop(unsigned int rangeStopP) { portRangeStopM = rangeStopP; }
   void SetRtpRcvBufSize(size_t sizeP) { rtpRcvBufSizeM = sizeP; }
+  void SetThreadCpus(unsigned int classP, const char *cpusP);
+  void SetThreadPolicy(unsigned int classP, unsigned int policyP);
+  void SetThreadPriority(unsigned int classP, unsigned int priorityP);
 };
 
 extern cSatipConfig SatipConfig;
@@ -16,8 +16,8 @@
 #include "device.h"
 
 std::vector<cSatipDevice*> SatipDevices;
-
-cMutex cSatipDevice::SetChannelMtx = cMutex();
+// Guards the speculative and shared sessions of all devices
+static cMutex SatipSessionMutex;
 
 cSatipDevice::cSatipDevice(unsigned int DeviceIndex) :
   deviceIndex(DeviceIndex),
@@ -27,7 +27,14 @@ cSatipDevice::cSatipDevice(unsigned int DeviceIndex) :
   currentChannel(),
   SectionFilterHandler(nullptr),
   ReadyTimeout(0),
-  tunerLocked()
+  tunerMutex(),
+  tunerLocked(),
+  preTunedM(false),
+  preTuneLiveM(nullptr),
+  preTuneServerM(nullptr),
+  preTuneTransponderM(0),
+  preTunePmtPidM(0),
+  shareOwnerM(nullptr)
 {
   size_t bufsize = SATIP_BUFFER_SIZE;
   bufsize -= (bufsize % TS_SIZE);
@@ -67,6 +74,12 @@ bool cSatipDevice::Initialize(int DeviceCount) {
 
 void cSatipDevice::Shutdown(void) {
   dbg_funcname("%s", __PRETTY_FUNCTION__);
+  {
+  // No tuner may feed another device after this
+  cMutexLock SessionLock(&SatipSessionMutex);
+  for(auto device:SatipDevices)
+     device->LeaveShare();
+  }
   for(auto device:SatipDevices)
      device->CloseDvr();
 }
@@ -124,13 +137,14 @@ cString cSatipDevice::GetGeneralInformation(void)
 {
   dbg_funcname_ext("%s [device %d]", __PRETTY_FUNCTION__, deviceIndex);
   LOCK_CHANNELS_READ;
-  return cString::sprintf("SAT>IP device: %d\nCardIndex: %d\nStream: %s\nSignal: %s\nStream bitrate: %s\n%sChannel: %s\n",
+  return cString::sprintf("SAT>IP device: %d\nCardIndex: %d\nStream: %s\nSignal: %s\nStream bitrate: %s\n%sChannel: %s\nThreads: %s\n",
                           deviceIndex, CardIndex(),
                           tuner ? *tuner->GetInformation() : "",
                           tuner ? *tuner->GetSignalStatus() : "",
                           tuner ? *tuner->GetTunerStatistic() : "",
                           *GetBufferStatistic(),
-                          *Channels->GetByNumber(cDevice::CurrentChannel())->ToText());
+                          *Channels->GetByNumber(cDevice::CurrentChannel())->ToText(),
+                          *GetThreadScheduling());
 }
 
 cString cSatipDevice::GetPidsInformation(void)
@@ -214,7 +228,7 @@ bool cSatipDevice::SignalStats(int &Valid, double *Strength, double *Cnr, double
   dbg_funcname_ext("%s [device %d]", __PRETTY_FUNCTION__, deviceIndex);
   Valid = DTV_STAT_VALID_NONE;
   if (Strength && tuner) {
-     *Strength =  tuner->SignalStrengthDBm();
+     *Strength =  ActiveTuner()->SignalStrengthDBm();
      if (*Strength < -18.0) /* valid: -71.458 .. -18.541, invalid: 0.0 */
         Valid |= DTV_STAT_VALID_STRENGTH;
      }
@@ -228,33 +242,22 @@ bool cSatipDevice::SignalStats(int &Valid, double *Strength, double *Cnr, double
 int cSatipDevice::SignalStrength(void) const
 {
   dbg_funcname_ext("%s [device %d]", __PRETTY_FUNCTION__, deviceIndex);
-  return (tuner ? tuner->SignalStrength() : -1);
+  return (tuner ? ActiveTuner()->SignalStrength() : -1);
 }
 
 int cSatipDevice::SignalQuality(void) const
 {
   dbg_funcname_ext("%s [device %d]", __PRETTY_FUNCTION__, deviceIndex);
-  return (tuner ? tuner->SignalQuality() : -1);
+  return (tuner ? ActiveTuner()->SignalQuality() : -1);
 }
 
 bool cSatipDevice::ProvidesSource(int sourceP) const
 {
-  cSource *s = Sources.Get(sourceP);
-  dbg_chan_switch("%s (%c) desc='%s' [device %d]", __PRETTY_FUNCTION__, cSource::ToChar(sourceP), s ? s->Description() : "", deviceIndex);
+  dbg_chan_switch("%s (%s) [device %d]", __PRETTY_FUNCTION__, *cSource::ToString(sourceP), deviceIndex);
   if (SatipConfig.GetDetachedMode())
      return false;
-  // source descriptions starting with '0' are disabled
-  if (s && s->Description() && (*(s->Description()) == '0'))
-     return false;
-  if (!SatipConfig.IsOperatingModeOff() && !!cSatipDiscover::GetInstance()->GetServer(sourceP)) {
-     int numDisabledSourcesM = SatipConfig.GetDisabledSourcesCount();
-     for (int i = 0; i < numDisabledSourcesM; ++i) {
-         if (sourceP == SatipConfig.GetDisabledSources(i))
-            return false;
-         }
-     return true;
-     }
-  return false;
+  // The index covers the servers, the disabled sources and the source descriptions starting with '0'
+  return !SatipConfig.IsOperatingModeOff() && cSatipDiscover::GetInstance()->ProvidesSource(sourceP);
 }
 
 bool cSatipDevice::ProvidesTransponder(const cChannel *channelP) const
@@ -333,7 +336,7 @@ const cChannel *cSatipDevice::GetCurrentlyTunedTransponder(void) const
 
 bool cSatipDevice::IsTunedToTransponder(const cChannel *channelP) const
 {
-  if (tuner && !tuner->IsTuned())
+  if (tuner && !ActiveTuner()->IsTuned())
      return false;
   if ((currentChannel.Source() != channelP->Source()) || (currentChannel.Transponder() != channelP->Transponder()))
      return false;
@@ -347,7 +350,17 @@ bool cSatipDevice::MaySwitchTransponder(const cChannel *channelP) const
 
 bool cSatipDevice::SetChannelDevice(const cChannel* channel, bool liveView)
 {
-  cMutexLock MutexLock(&SetChannelMtx);  // Global lock to prevent any simultaneous zapping
+  bool result = TuneChannel(channel, liveView);
+  // Warm up the neighbour transponders only after this device has been released
+  if (result && channel && liveView)
+     PreTune(this, channel);
+  return result;
+}
+
+bool cSatipDevice::TuneChannel(const cChannel* channel, bool liveView)
+{
+  // Frontends are reserved while tuning, so only zapping of this very device needs to be serialized
+  cMutexLock MutexLock(&tunerMutex);
   dbg_chan_switch("%s (%d, %d) [device %d]",
       __PRETTY_FUNCTION__, channel ? channel->Number() : -1, liveView, deviceIndex);
 
@@ -364,10 +377,23 @@ bool cSatipDevice::SetChannelDevice(const cChannel* channel, bool liveView)
         }
 
      auto discover = cSatipDiscover::GetInstance();
-     auto server = discover->AssignServer(deviceIndex,
-                                          channel->Source(),
-                                          channel->Transponder(),
-                                          cDvbTransponderParameters(channel->Parameters()).System());
+     int system = cDvbTransponderParameters(channel->Parameters()).System();
+     bool tuned = false;
+     {
+     // Real tuning requests always take over any speculative sessions
+     cMutexLock SessionLock(&SatipSessionMutex);
+     if (preTunedM)
+        StopPreTuning(false);
+     LeaveShare();
+     if (!IsTunedToTransponder(channel))
+        MigrateShares();
+     if (JoinShare(channel)) {
+        currentChannel = *channel;
+        return true;
+        }
+     auto server = discover->AssignServer(deviceIndex, channel->Source(), channel->Transponder(), system);
+     if (!server && CancelPreTuning())
+        server = discover->AssignServer(deviceIndex, channel->Source(), channel->Transponder(), system);
 
      if (!server) {
         dbg_chan_switch("%s No server for %s [device %d]",
@@ -376,21 +402,250 @@ bool cSatipDevice::SetChannelDevice(const cChannel* channel, bool liveView)
         }
 
      serverString = *discover->GetServerString(server);
-
-     if (tuner->SetSource(server, channel->Transponder(), params.c_str(), deviceIndex)) {
+     tuned = tuner->SetSource(server, channel->Transponder(), params.c_str(), deviceIndex);
+     // Updated under the lock as other devices compare their channels against it
+     if (tuned)
         currentChannel = *channel;
-        // Wait for actual channel tuning to prevent simultaneous frontend allocation failures
-        tunerLocked.TimedWait(SetChannelMtx, eTuningTimeoutMs);
+     }
+
+     if (tuned) {
+        // Wait for actual channel tuning
+        tunerLocked.TimedWait(tunerMutex, eTuningTimeoutMs);
         return true;
         }
      }
   else {
+     cMutexLock SessionLock(&SatipSessionMutex);
+     if (preTunedM)
+        StopPreTuning(false);
+     LeaveShare();
+     MigrateShares();
      tuner->SetSource(nullptr, 0, nullptr, deviceIndex);
      serverString.clear();
      }
   return true;
 }
 
+bool cSatipDevice::Failover(void)
+{
+  cMutexLock MutexLock(&tunerMutex);
+  cMutexLock SessionLock(&SatipSessionMutex);
+  // Speculative and shared sessions are simply dropped instead
+  if (!tuner || preTunedM || shareOwnerM || serverString.empty() || !tuner->IsServerBlocked())
+     return false;
+
+  std::string params = GetTransponderUrlParameters(&currentChannel);
+  if (params.empty())
+     return false;
+
+  auto discover = cSatipDiscover::GetInstance();
+  auto server = discover->AssignServer(deviceIndex, currentChannel.Source(), currentChannel.Transponder(),
+                                       cDvbTransponderParameters(currentChannel.Parameters()).System());
+  if (!server)
+     return false;
+
+  if (!tuner->SetSource(server, currentChannel.Transponder(), params.c_str(), deviceIndex)) {
+     discover->DetachServer(server, deviceIndex, currentChannel.Transponder());
+     return false;
+     }
+  serverString = *discover->GetServerString(server);
+  info("Moved %s to %s [device %d]", *currentChannel.ToText(), serverString.c_str(), deviceIndex);
+  return true;
+}
+
+bool cSatipDevice::StartPreTuning(const cSatipDevice *liveDeviceP, const cChannel *channelP)
+{
+  std::string params = GetTransponderUrlParameters(channelP);
+  if (params.empty())
+     return false;
+
+  auto discover = cSatipDiscover::GetInstance();
+  auto server = discover->AssignServer(deviceIndex,
+                                       channelP->Source(),
+                                       channelP->Transponder(),
+                                       cDvbTransponderParameters(channelP->Parameters()).System());
+  if (!server)
+     return false;
+
+  dbg_chan_switch("%s Pre-tuning %s [device %d]", __PRETTY_FUNCTION__, *channelP->ToText(), deviceIndex);
+  if (!tuner->SetSource(server, channelP->Transponder(), params.c_str(), deviceIndex)) {
+     discover->DetachServer(server, deviceIndex, channelP->Transponder());
+     return false;
+     }
+  // A minimal pid set keeps the session alive: PAT and the PMT if known
+  preTunePmtPidM = ::GetPmtPid(channelP->Source(), channelP->Transponder(), channelP->Sid());
+  tuner->SetPid(0, ptOther, true);
+  if (preTunePmtPidM > 0)
+     tuner->SetPid(preTunePmtPidM, ptOther, true);
+  currentChannel = *channelP;
+  serverString = *discover->GetServerString(server);
+  preTuneLiveM = liveDeviceP;
+  preTuneServerM = server;
+  preTuneTransponderM = channelP->Transponder();
+  preTunedM = true;
+  return true;
+}
+
+void cSatipDevice::StopPreTuning(bool releaseP)
+{
+  dbg_chan_switch("%s (%d) [device %d]", __PRETTY_FUNCTION__, releaseP, deviceIndex);
+  // Keep the pids still used by section filters
+  if (!SectionFilterHandler || !SectionFilterHandler->Exists(0))
+     tuner->SetPid(0, ptOther, false);
+  if ((preTunePmtPidM > 0) && (!SectionFilterHandler || !SectionFilterHandler->Exists(preTunePmtPidM)))
+     tuner->SetPid(preTunePmtPidM, ptOther, false);
+  if (releaseP) {
+     tuner->Release();
+     serverString.clear();
+     // Free the frontend at once for any real tuning request
+     cSatipDiscover::GetInstance()->DetachServer(preTuneServerM, deviceIndex, preTuneTransponderM);
+     }
+  preTuneLiveM = nullptr;
+  preTuneServerM = nullptr;
+  preTuneTransponderM = 0;
+  preTunePmtPidM = 0;
+  preTunedM = false;
+}
+
+bool cSatipDevice::JoinShare(const cChannel *channelP)
+{
+  // The CI extension decrypts only the channel of the session owner
+  if (!SatipConfig.GetFrontendReuse() || (SatipConfig.GetCIExtension() && channelP->Ca()))
+     return false;
+  // Releasing our session would cut off the devices sharing it
+  if (tuner->ShareCount())
+     return false;
+  for (auto device:SatipDevices) {
+      if ((device == this) || !device->tuner || device->shareOwnerM || device->preTunedM || device->serverString.empty() || device->tuner->IsReleased())
+         continue;
+      if ((device->currentChannel.Source() != channelP->Source()) || (device->currentChannel.Transponder() != channelP->Transponder()) ||
+          strcmp(device->currentChannel.Parameters(), channelP->Parameters()))
+         continue;
+      if (!tuner->JoinShare(device->tuner))
+         continue;
+      dbg_chan_switch("%s Sharing %s with device %d [device %d]", __PRETTY_FUNCTION__, *channelP->ToText(), device->deviceIndex, deviceIndex);
+      // Our own session isn't needed anymore
+      if (!tuner->IsReleased())
+         tuner->Release();
+      shareOwnerM = device;
+      serverString = *cString::sprintf("%s (device %d)", device->serverString.c_str(), device->deviceIndex);
+      return true;
+      }
+  return false;
+}
+
+void cSatipDevice::LeaveShare(void)
+{
+  if (shareOwnerM) {
+     dbg_chan_switch("%s Leaving device %d [device %d]", __PRETTY_FUNCTION__, shareOwnerM->deviceIndex, deviceIndex);
+     tuner->LeaveShare();
+     shareOwnerM = nullptr;
+     serverString.clear();
+     }
+}
+
+void cSatipDevice::MigrateShares(void)
+{
+  // The sharers get sessions of their own before this one moves elsewhere
+  auto discover = cSatipDiscover::GetInstance();
+  for (auto device:SatipDevices) {
+      if (device->shareOwnerM != this)
+         continue;
+      device->LeaveShare();
+      const cChannel *channel = &device->currentChannel;
+      std::string params = GetTransponderUrlParameters(channel);
+      auto server = params.empty() ? nullptr : discover->AssignServer(device->deviceIndex, channel->Source(), channel->Transponder(),
+                                                                      cDvbTransponderParameters(channel->Parameters()).System());
+      if (server && device->tuner->SetSource(server, channel->Transponder(), params.c_str(), device->deviceIndex)) {
+         dbg_chan_switch("%s Moved device %d to own session [device %d]", __PRETTY_FUNCTION__, device->deviceIndex, deviceIndex);
+         device->serverString = *discover->GetServerString(server);
+         }
+      else {
+         error("Cannot move shared transponder %s to device %d [device %d]", *channel->ToText(), device->deviceIndex, deviceIndex);
+         }
+      }
+}
+
+bool cSatipDevice::CancelPreTuning(void)
+{
+  cMutexLock SessionLock(&SatipSessionMutex);
+  bool result = false;
+  for (auto device:SatipDevices) {
+      if (device->preTunedM) {
+         device->StopPreTuning(true);
+         result = true;
+         }
+      }
+  return result;
+}
+
+void cSatipDevice::PreTune(const cSatipDevice *liveDeviceP, const cChannel *channelP)
+{
+  if (!SatipConfig.GetPreTuning()) {
+     CancelPreTuning();
+     return;
+     }
+
+  // Find the nearest channels on other transponders in both directions
+  cChannel neighbours[2];
+  int count = 0;
+  cStateKey StateKey;
+  // The caller might hold the channels lock already, so never wait for it
+  if (const cChannels *Channels = cChannels::GetChannelsRead(StateKey, eChannelsLockTimeoutMs)) {
+     for (int direction = 1; direction >= -1; direction -= 2) {
+         const cChannel *c = channelP;
+         for (int i = 0; c && (i < ePreTuneMaxSteps); ++i) {
+             c = Channels->GetByNumber(c->Number() + direction, direction);
+             if (!c || (c == channelP))
+                break;
+             if ((c->Source() == channelP->Source()) && (c->Transponder() == channelP->Transponder()))
+                continue;
+             if (count && (c->Source() == neighbours[0].Source()) && (c->Transponder() == neighbours[0].Transponder()))
+                break;
+             if (liveDeviceP->ProvidesTransponder(c))
+                neighbours[count++] = *c;
+             break;
+             }
+         }
+     StateKey.Remove();
+     }
+
+  // Receiving() takes the receiver lock of VDR, so ask before taking the session lock
+  bool receiving[SATIP_MAX_DEVICES] = { false };
+  for (size_t i = 0; i < SatipDevices.size(); ++i)
+      receiving[i] = SatipDevices[i]->Receiving();
+
+  cMutexLock SessionLock(&SatipSessionMutex);
+  bool wanted[2] = { false, false };
+  // Drop the sessions not needed anymore including the one handed over to the live device
+  for (auto device:SatipDevices) {
+      if (!device->preTunedM)
+         continue;
+      bool keep = false;
+      for (int i = 0; i < count; ++i) {
+          if (!wanted[i] && (device->currentChannel.Source() == neighbours[i].Source()) && (device->currentChannel.Transponder() == neighbours[i].Transponder())) {
+             wanted[i] = keep = true;
+             break;
+             }
+          }
+      if (!keep)
+         device->StopPreTuning(true);
+      }
+  // Use only idle devices for the missing ones
+  for (int i = 0; i < count; ++i) {
+      if (wanted[i])
+         continue;
+      for (size_t j = 0; j < SatipDevices.size(); ++j) {
+          cSatipDevice *device = SatipDevices[j];
+          if ((device != liveDeviceP) && !device->preTunedM && !device->shareOwnerM && !receiving[j] && !device->dvrIsOpen &&
+              device->tuner && device->tuner->IsReleased()) {
+             if (device->StartPreTuning(liveDeviceP, &neighbours[i]))
+                break;
+             }
+          }
+      }
+}
+
 void cSatipDevice::SetChannelTuned(void)
 {
   dbg_chan_switch("%s () [device %d]", __PRETTY_FUNCTION__, deviceIndex);
@@ -403,20 +658,27 @@ bool cSatipDevice::SetPid(cPidHandle *handleP, int typeP, bool onP)
   dbg_pids("%s (%d, %d, %d) [device %d]", __PRETTY_FUNCTION__, handleP ? handleP->pid : -1, typeP, onP, deviceIndex);
   if (tuner && handleP && handleP->pid >= 0 && handleP->pid <= 8191) {
      if (onP)
-        return tuner->SetPid(handleP->pid, typeP, true);
+        return SetTunerPid(handleP->pid, typeP, true);
      else if (!handleP->used && SectionFilterHandler && !SectionFilterHandler->Exists(handleP->pid))
-        return tuner->SetPid(handleP->pid, typeP, false);
+        return SetTunerPid(handleP->pid, typeP, false);
      }
   return true;
 }
 
+bool cSatipDevice::SetTunerPid(int pidP, int typeP, bool onP)
+{
+  // Our own tuner always knows the pids in case the shared session moves away and passes them on to the owner.
+  // No session lock here: VDR calls this with its receiver lock held, which the session code waits for.
+  return tuner->SetPid(pidP, typeP, onP);
+}
+
 int cSatipDevice::OpenFilter(unsigned short pidP, unsigned char tidP, unsigned char maskP)
 {
   dbg_pids("%s (%d, %02X, %02X) [device %d]", __PRETTY_FUNCTION__, pidP, tidP, maskP, deviceIndex);
   if (SectionFilterHandler) {
      int handle = SectionFilterHandler->Open(pidP, tidP, maskP);
      if (tuner && (handle >= 0))
-        tuner->SetPid(pidP, ptOther, true);
+        SetTunerPid(pidP, ptOther, true);
      return handle;
      }
   return -1;
@@ -428,7 +690,7 @@ void cSatipDevice::CloseFilter(int handleP)
      int pid = SectionFilterHandler->GetPid(handleP);
      dbg_pids("%s (%d) [device %d]", __PRETTY_FUNCTION__, pid, deviceIndex);
      if (tuner)
-        tuner->SetPid(pid, ptOther, false);
+        SetTunerPid(pid, ptOther, false);
      SectionFilterHandler->Close(handleP);
      }
 }
@@ -458,12 +720,12 @@ bool cSatipDevice::HasLock(int timeout) const {
   while(timeout > 0) {
      if (not tuner)
         return false;
-     if (tuner->HasLock())
+     if (ActiveTuner()->HasLock())
         return true;
      cCondWait::SleepMs(interval);
      timeout -= interval;
      }
-  return tuner && tuner->HasLock();
+  return tuner && ActiveTuner()->HasLock();
 }
 
 bool cSatipDevice::HasInternalCam(void)
@@ -527,6 +789,27 @@ cString cSatipDevice::GetTnrParameterString(void)
 
 bool cSatipDevice::IsIdle(void)
 {
+  // Receiving() takes the receiver lock of VDR, so only a snapshot is taken under the session lock
+  const cSatipDevice *live = nullptr;
+  cSatipDevice *sharers[SATIP_MAX_DEVICES];
+  int count = 0;
+  {
+  cMutexLock SessionLock(&SatipSessionMutex);
+  // Speculative sessions live as long as the live view they were started for
+  if (preTunedM)
+     live = preTuneLiveM;
+  // A shared session is busy as long as any of its sharers is
+  for (auto device:SatipDevices) {
+      if (device->shareOwnerM == this)
+         sharers[count++] = device;
+      }
+  }
+  if (live)
+     return !live->Receiving();
+  for (int i = 0; i < count; ++i) {
+      if (sharers[i]->Receiving())
+         return false;
+      }
   return !Receiving();
 }
 
@@ -29,9 +29,13 @@ public:
   // private parts
 private:
   enum {
-    eReadyTimeoutMs  = 2000, // in milliseconds
-    eTuningTimeoutMs = 1000  // in milliseconds
+    eReadyTimeoutMs        = 2000, // in milliseconds
+    eTuningTimeoutMs       = 1000, // in milliseconds
+    eChannelsLockTimeoutMs = 10,   // in milliseconds
+    ePreTuneMaxSteps       = 100   // channels to look for a neighbour transponder
   };
+  static void PreTune(const cSatipDevice *liveDeviceP, const cChannel *channelP);
+  static bool CancelPreTuning(void);
   int deviceIndex;
   int bytesDelivered;
   bool dvrIsOpen;
@@ -42,7 +46,22 @@ private:
   cSatipTuner* tuner;
   cSatipSectionFilterHandler* SectionFilterHandler;
   cTimeMs ReadyTimeout;
+  cMutex tunerMutex;
   cCondVar tunerLocked;
+  bool preTunedM;
+  const cSatipDevice *preTuneLiveM;
+  cSatipServer *preTuneServerM;
+  int preTuneTransponderM;
+  int preTunePmtPidM;
+  cSatipDevice *shareOwnerM;
+  bool StartPreTuning(const cSatipDevice *liveDeviceP, const cChannel *channelP);
+  void StopPreTuning(bool releaseP);
+  bool JoinShare(const cChannel *channelP);
+  void LeaveShare(void);
+  void MigrateShares(void);
+  bool SetTunerPid(int pidP, int typeP, bool onP);
+  cSatipTuner *ActiveTuner(void) const { return shareOwnerM ? shareOwnerM->tuner : tuner; }
+  bool TuneChannel(const cChannel* channel, bool liveView);
 
   // constructor & destructor
 public:
@@ -52,7 +71,6 @@ public:
 
   // copy and assignment constructors
 private:
-  static cMutex SetChannelMtx;
   cSatipDevice(const cSatipDevice&);
   cSatipDevice& operator=(const cSatipDevice&);
 
@@ -118,6 +136,7 @@ public:
   virtual int GetCISlot(void);
   virtual cString GetTnrParameterString(void);
   virtual bool IsIdle(void);
+  virtual bool Failover(void);
 };
 
 #endif // __SATIP_DEVICE_H
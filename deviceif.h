@@ -19,6 +19,7 @@ public:
   virtual int GetCISlot(void) = 0;
   virtual cString GetTnrParameterString(void) = 0;
   virtual bool IsIdle(void) = 0;
+  virtual bool Failover(void) = 0;
 
 private:
   explicit cSatipDeviceIf(const cSatipDeviceIf&);
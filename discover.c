@@ -5,6 +5,7 @@
  *
  */
 
+#include <inttypes.h>
 #include <string.h>
 #ifdef USE_TINYXML
  #include <tinyxml.h>
@@ -26,16 +27,22 @@ cSatipDiscover *cSatipDiscover::GetInstance(void)
   return instanceS;
 }
 
-bool cSatipDiscover::Initialize(cSatipDiscoverServers *serversP)
+bool cSatipDiscover::Initialize(cSatipDiscoverServers *serversP, const char *configDirP)
 {
-  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, configDirP);
   if (instanceS) {
      if (serversP) {
         for (cSatipDiscoverServer *s = serversP->First(); s; s = serversP->Next(s))
-            instanceS->AddServer(s->SrcAddress(), s->IpAddress(), s->IpPort(), s->Model(), s->Filters(), s->Description(), s->Quirk());
+            instanceS->AddServer(s->SrcAddress(), s->IpAddress(), s->IpPort(), s->Model(), s->Filters(), s->Description(), s->Quirk(), s->PidLimit());
         }
-     else
+     else {
+        // Only the discovered servers are cached
+        if (!isempty(configDirP)) {
+           instanceS->cacheFileM = AddDirectory(configDirP, "servers.cache");
+           instanceS->LoadCache();
+           }
         instanceS->Activate();
+        }
      }
   return true;
 }
@@ -49,7 +56,7 @@ void cSatipDiscover::Destroy(void)
 
 size_t cSatipDiscover::HeaderCallback(char *ptrP, size_t sizeP, size_t nmembP, void *dataP)
 {
-  cSatipDiscover *obj = reinterpret_cast<cSatipDiscover *>(dataP);
+  cSatipDiscoverFetch *obj = reinterpret_cast<cSatipDiscoverFetch *>(dataP);
   size_t len = sizeP * nmembP;
   dbg_funcname_ext("%s len=%zu", __PRETTY_FUNCTION__, len);
 
@@ -61,7 +68,7 @@ size_t cSatipDiscover::HeaderCallback(char *ptrP, size_t sizeP, size_t nmembP, v
 
 size_t cSatipDiscover::DataCallback(char *ptrP, size_t sizeP, size_t nmembP, void *dataP)
 {
-  cSatipDiscover *obj = reinterpret_cast<cSatipDiscover *>(dataP);
+  cSatipDiscoverFetch *obj = reinterpret_cast<cSatipDiscoverFetch *>(dataP);
   size_t len = sizeP * nmembP;
   dbg_funcname_ext("%s len=%zu", __PRETTY_FUNCTION__, len);
 
@@ -103,14 +110,17 @@ int cSatipDiscover::DebugCallback(CURL *handleP, curl_infotype typeP, char *data
 cSatipDiscover::cSatipDiscover()
 : cThread("SATIP discover"),
   mutexM(),
-  headerBufferM(),
-  dataBufferM(),
   msearchM(*this),
   probeUrlListM(),
-  handleM(curl_easy_init()),
+  seenUrlListM(),
+  multiM(curl_multi_init()),
   sleepM(),
   probeIntervalM(0),
-  serversM()
+  verifyTimeoutM(0),
+  serversM(),
+  cacheFileM(""),
+  cacheDirtyM(false),
+  unverifiedM(false)
 {
   dbg_funcname("%s", __PRETTY_FUNCTION__);
 }
@@ -121,10 +131,11 @@ cSatipDiscover::~cSatipDiscover()
   Deactivate();
   cMutexLock MutexLock(&mutexM);
   // Free allocated memory
-  if (handleM)
-     curl_easy_cleanup(handleM);
-  handleM = NULL;
+  if (multiM)
+     curl_multi_cleanup(multiM);
+  multiM = NULL;
   probeUrlListM.Clear();
+  seenUrlListM.Clear();
 }
 
 void cSatipDiscover::Activate(void)
@@ -145,17 +156,27 @@ void cSatipDiscover::Deactivate(void)
 void cSatipDiscover::Action(void)
 {
   dbg_funcname("%s Entering", __PRETTY_FUNCTION__);
-  probeIntervalM.Set(eProbeIntervalMs);
+  SetThreadScheduling(SATIP_THREAD_DISCOVER);
+  verifyTimeoutM.Set(eVerifyTimeoutMs);
   msearchM.Probe();
+  probeIntervalM.Set(msearchM.IsListening(eNotifyTimeoutMs) ? eNotifyProbeIntervalMs : eProbeIntervalMs);
   // Do the thread loop
   while (Running()) {
         cStringList tmp;
 
         if (probeIntervalM.TimedOut()) {
-           probeIntervalM.Set(eProbeIntervalMs);
+           bool listening = msearchM.IsListening(eNotifyTimeoutMs);
+           probeIntervalM.Set(listening ? eNotifyProbeIntervalMs : eProbeIntervalMs);
+           mutexM.Lock();
+           // Every probe cycle fetches each description once
+           seenUrlListM.Clear();
+           mutexM.Unlock();
            msearchM.Probe();
            mutexM.Lock();
-           serversM.Cleanup(eCleanupTimeoutMs);
+           int count = serversM.Count();
+           serversM.Cleanup(listening ? eNotifyCleanupTimeoutMs : eCleanupTimeoutMs);
+           if (serversM.Count() != count)
+              ServersChanged();
            mutexM.Unlock();
            }
         mutexM.Lock();
@@ -164,95 +185,201 @@ void cSatipDiscover::Action(void)
                tmp.Insert(strdup(probeUrlListM.At(i)));
            probeUrlListM.Clear();
            }
+        // Cached servers not confirmed by the first probe cycle are gone
+        if (unverifiedM && verifyTimeoutM.TimedOut()) {
+           unverifiedM = false;
+           if (serversM.CleanupUnverified())
+              ServersChanged();
+           }
         mutexM.Unlock();
         if (tmp.Size()) {
-           for (int i = 0; i < tmp.Size(); ++i)
-               Fetch(tmp.At(i));
+           Fetch(tmp);
            tmp.Clear();
            }
+        if (cacheDirtyM)
+           SaveCache();
         // to avoid busy loop and reduce cpu load
         sleepM.Wait(eSleepTimeoutMs);
         }
   dbg_funcname("%s Exiting", __PRETTY_FUNCTION__);
 }
 
-void cSatipDiscover::Fetch(const char *urlP)
+bool cSatipDiscover::Prepare(cSatipDiscoverFetch &fetchP)
 {
-  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, urlP);
-  if (handleM && !isempty(urlP)) {
-     const char *addr = NULL;
-     long rc = 0;
-     CURLcode res = CURLE_OK;
+  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, *fetchP.urlM);
+  CURL *handle = fetchP.handleM;
+  if (!handle)
+     return false;
+
+  CURLcode res = CURLE_OK;
+
+  // Verbose output
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_VERBOSE, 1L);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_DEBUGFUNCTION, cSatipDiscover::DebugCallback);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_DEBUGDATA, this);
 
-     // Verbose output
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_VERBOSE, 1L);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_DEBUGFUNCTION, cSatipDiscover::DebugCallback);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_DEBUGDATA, this);
+  // Set header and data callbacks
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_HEADERFUNCTION, cSatipDiscover::HeaderCallback);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_WRITEHEADER, &fetchP);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_WRITEFUNCTION, cSatipDiscover::DataCallback);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_WRITEDATA, &fetchP);
 
-     // Set header and data callbacks
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_HEADERFUNCTION, cSatipDiscover::HeaderCallback);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEHEADER, this);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEFUNCTION, cSatipDiscover::DataCallback);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, this);
+  // No progress meter and no signaling
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_NOPROGRESS, 1L);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_NOSIGNAL, 1L);
 
-     // No progress meter and no signaling
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_NOPROGRESS, 1L);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_NOSIGNAL, 1L);
+  // Set timeouts; these apply to each request on its own
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_TIMEOUT_MS, (long)eConnectTimeoutMs);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_CONNECTTIMEOUT_MS, (long)eConnectTimeoutMs);
 
-     // Set timeouts
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_TIMEOUT_MS, (long)eConnectTimeoutMs);
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_CONNECTTIMEOUT_MS, (long)eConnectTimeoutMs);
+  // Set user-agent
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_USERAGENT, *cString::sprintf("vdr-%s/%s", PLUGIN_NAME_I18N, VERSION));
 
-     // Set user-agent
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_USERAGENT, *cString::sprintf("vdr-%s/%s", PLUGIN_NAME_I18N, VERSION));
+  // Set URL
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_URL, *fetchP.urlM);
+  SATIP_CURL_EASY_SETOPT(handle, CURLOPT_PRIVATE, &fetchP);
 
-     // Set URL
-     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_URL, urlP);
+  return true;
+}
 
-     // Fetch the data
-     SATIP_CURL_EASY_PERFORM(handleM);
-     SATIP_CURL_EASY_GETINFO(handleM, CURLINFO_RESPONSE_CODE, &rc);
-     SATIP_CURL_EASY_GETINFO(handleM, CURLINFO_PRIMARY_IP, &addr);
-     if (rc == 200) {
-        ParseDeviceInfo(addr, ParseRtspPort());
-        headerBufferM.Reset();
-        dataBufferM.Reset();
+void cSatipDiscover::Complete(cSatipDiscoverFetch &fetchP, CURLcode resultP)
+{
+  dbg_funcname("%s (%s, %d)", __PRETTY_FUNCTION__, *fetchP.urlM, resultP);
+  const char *addr = NULL;
+  long rc = 0;
+  CURLcode res = CURLE_OK;
+
+  if (resultP != CURLE_OK) {
+     error("Discovery of %s failed: %s (%d)", *fetchP.urlM, curl_easy_strerror(resultP), resultP);
+     return;
+     }
+  SATIP_CURL_EASY_GETINFO(fetchP.handleM, CURLINFO_RESPONSE_CODE, &rc);
+  SATIP_CURL_EASY_GETINFO(fetchP.handleM, CURLINFO_PRIMARY_IP, &addr);
+  if (rc == 200)
+     ParseDeviceInfo(fetchP, addr, ParseRtspPort(fetchP));
+  else
+     error("Discovery detected invalid status code: %ld", rc);
+}
+
+void cSatipDiscover::Fetch(cStringList &urlsP)
+{
+  dbg_funcname("%s (%d)", __PRETTY_FUNCTION__, urlsP.Size());
+  // All descriptions are fetched concurrently, so an unresponsive server only delays itself
+  cVector<cSatipDiscoverFetch *> fetches;
+  for (int i = 0; i < urlsP.Size(); ++i) {
+      if (isempty(urlsP.At(i)))
+         continue;
+      cSatipDiscoverFetch *fetch = new cSatipDiscoverFetch(urlsP.At(i));
+      if (multiM && Prepare(*fetch) && (curl_multi_add_handle(multiM, fetch->handleM) == CURLM_OK))
+         fetches.Append(fetch);
+      else
+         delete fetch;
+      }
+
+  int running = fetches.Size();
+  while (running && Running()) {
+        CURLMcode mc = curl_multi_perform(multiM, &running);
+        int left = 0;
+        CURLMsg *msg;
+        while ((msg = curl_multi_info_read(multiM, &left)) != NULL) {
+              if (msg->msg == CURLMSG_DONE) {
+                 char *ptr = NULL;
+                 curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &ptr);
+                 if (ptr)
+                    Complete(*reinterpret_cast<cSatipDiscoverFetch *>(ptr), msg->data.result);
+                 }
+              }
+        if (mc != CURLM_OK) {
+           error("Discovery failed: %s (%d)", curl_multi_strerror(mc), mc);
+           break;
+           }
+        if (running)
+           curl_multi_wait(multiM, NULL, 0, eFetchWaitMs, NULL);
         }
-     else
-        error("Discovery detected invalid status code: %ld", rc);
+
+  for (int i = 0; i < fetches.Size(); ++i) {
+      curl_multi_remove_handle(multiM, fetches[i]->handleM);
+      delete fetches[i];
+      }
+}
+
+void cSatipDiscover::LoadCache(void)
+{
+  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, *cacheFileM);
+  FILE *f = fopen(*cacheFileM, "r");
+  if (!f)
+     return;
+  cMutexLock MutexLock(&mutexM);
+  cReadLine ReadLine;
+  char *line;
+  while ((line = ReadLine.Read(f)) != NULL) {
+        // <address>|<port>|<quirks>|<model>|<description>
+        char *field[5];
+        unsigned int n = 0;
+        char *p = line;
+        field[n++] = p;
+        while ((n < ELEMENTS(field)) && ((p = strchr(p, '|')) != NULL)) {
+              *p++ = 0;
+              field[n++] = p;
+              }
+        if ((n < ELEMENTS(field)) || isempty(field[0])) {
+           error("Invalid entry in server cache %s", *cacheFileM);
+           continue;
+           }
+        int port = atoi(field[1]);
+        int quirk = SatipConfig.GetDisableServerQuirks() ? cSatipServer::eSatipQuirkNone : (int)strtol(field[2], NULL, 0) & cSatipServer::eSatipQuirkMask;
+        cSatipServer *tmp = new cSatipServer(NULL, field[0], (port > 0) ? port : SATIP_DEFAULT_RTSP_PORT, field[3], NULL, field[4], quirk, 0);
+        if (serversM.Find(tmp)) {
+           DELETENULL(tmp);
+           continue;
+           }
+        tmp->Verify(false);
+        info("Adding cached server '%s|%s|%s' Quirks: %s", tmp->Address(), tmp->Model(), tmp->Description(), tmp->HasQuirk() ? tmp->Quirks() : "none");
+        serversM.Add(tmp);
+        unverifiedM = true;
+        }
+  fclose(f);
+  sourceIndexM.Build(serversM);
+}
+
+void cSatipDiscover::SaveCache(void)
+{
+  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, *cacheFileM);
+  cMutexLock MutexLock(&mutexM);
+  cacheDirtyM = false;
+  if (isempty(*cacheFileM))
+     return;
+  cSafeFile f(*cacheFileM);
+  if (f.Open()) {
+     for (cSatipServer *s = serversM.First(); s; s = serversM.Next(s))
+         fprintf(f, "%s|%d|0x%03X|%s|%s\n", s->Address(), s->Port(), s->QuirkMask(), s->Model(), s->Description());
+     f.Close();
      }
+  else
+     error("Cannot write server cache %s", *cacheFileM);
 }
 
-int cSatipDiscover::ParseRtspPort(void)
+int cSatipDiscover::ParseRtspPort(cSatipDiscoverFetch &fetchP)
 {
   dbg_funcname("%s", __PRETTY_FUNCTION__);
-  char *s, *p = headerBufferM.Data();
-  char *r = strtok_r(p, "\r\n", &s);
+  cSatipHeader header(fetchP.headerBufferM.Data(), fetchP.headerBufferM.Size());
   int port = SATIP_DEFAULT_RTSP_PORT;
 
-  while (r) {
-        dbg_funcname_ext("%s (%zu): %s", __PRETTY_FUNCTION__, headerBufferM.Size(), r);
-        r = skipspace(r);
-        if (strstr(r, "X-SATIP-RTSP-Port")) {
-           int tmp = -1;
-           if (sscanf(r, "X-SATIP-RTSP-Port:%11d", &tmp) == 1) {
-              port = tmp;
-              break;
-              }
-           }
-        r = strtok_r(NULL, "\r\n", &s);
-        }
+  if (header.Find("X-SATIP-RTSP-Port")) {
+     dbg_funcname_ext("%s (%zu): %.*s", __PRETTY_FUNCTION__, fetchP.headerBufferM.Size(), (int)header.LineLength(), header.Line());
+     port = header.IntValue(port);
+     }
 
   return port;
 }
 
-void cSatipDiscover::ParseDeviceInfo(const char *addrP, const int portP)
+void cSatipDiscover::ParseDeviceInfo(cSatipDiscoverFetch &fetchP, const char *addrP, const int portP)
 {
   dbg_funcname("%s (%s, %d)", __PRETTY_FUNCTION__, addrP, portP);
   const char *desc = NULL, *model = NULL;
 #ifdef USE_TINYXML
   TiXmlDocument doc;
-  doc.Parse(dataBufferM.Data());
+  doc.Parse(fetchP.dataBufferM.Data());
   TiXmlHandle docHandle(&doc);
   TiXmlElement *descElement = docHandle.FirstChild("root").FirstChild("device").FirstChild("friendlyName").ToElement();
   if (descElement)
@@ -262,7 +389,7 @@ void cSatipDiscover::ParseDeviceInfo(const char *addrP, const int portP)
      model = modelElement->GetText() ? modelElement->GetText() : "DVBS2-1";
 #else
   pugi::xml_document doc;
-  if (doc.load_buffer(dataBufferM.Data(), dataBufferM.Size())) {
+  if (doc.load_buffer(fetchP.dataBufferM.Data(), fetchP.dataBufferM.Size())) {
      pugi::xml_node descNode = doc.first_element_by_path("root/device/friendlyName");
      if (descNode)
         desc = descNode.text().as_string("MyBrokenHardware");
@@ -271,13 +398,14 @@ void cSatipDiscover::ParseDeviceInfo(const char *addrP, const int portP)
         model = modelNode.text().as_string("DVBS2-1");
      }
 #endif
-  AddServer(NULL, addrP, portP, model, NULL, desc, cSatipServer::eSatipQuirkNone);
+  AddServer(NULL, addrP, portP, model, NULL, desc, cSatipServer::eSatipQuirkNone, 0);
 }
 
-void cSatipDiscover::AddServer(const char *srcAddrP, const char *addrP, const int portP, const char *modelP, const char *filtersP, const char *descP, const int quirkP)
+void cSatipDiscover::AddServer(const char *srcAddrP, const char *addrP, const int portP, const char *modelP, const char *filtersP, const char *descP, const int quirkP, const int pidLimitP)
 {
-  dbg_funcname("%s (%s, %s, %d, %s, %s, %s, %d)", __PRETTY_FUNCTION__, srcAddrP, addrP, portP, modelP, filtersP, descP, quirkP);
+  dbg_funcname("%s (%s, %s, %d, %s, %s, %s, %d, %d)", __PRETTY_FUNCTION__, srcAddrP, addrP, portP, modelP, filtersP, descP, quirkP, pidLimitP);
   cMutexLock MutexLock(&mutexM);
+  bool added = false;
   if (SatipConfig.GetUseSingleModelServers() && modelP && !isempty(modelP)) {
      int n = 0;
      char *s, *p = strdup(modelP);
@@ -285,8 +413,9 @@ void cSatipDiscover::AddServer(const char *srcAddrP, const char *addrP, const in
      while (r) {
            r = skipspace(r);
            cString desc = cString::sprintf("%s #%d", !isempty(descP) ? descP : "MyBrokenHardware", n++);
-           cSatipServer *tmp = new cSatipServer(srcAddrP, addrP, portP, r, filtersP, desc, quirkP);
+           cSatipServer *tmp = new cSatipServer(srcAddrP, addrP, portP, r, filtersP, desc, quirkP, pidLimitP);
            if (!serversM.Update(tmp)) {
+              added = true;
               info("Adding server '%s|%s|%s' Bind: %s Filters: %s CI: %s Quirks: %s", tmp->Address(), tmp->Model(), tmp->Description(), !isempty(tmp->SrcAddress()) ? tmp->SrcAddress() : "default", !isempty(tmp->Filters()) ? tmp->Filters() : "none", tmp->HasCI() ? "yes" : "no", tmp->HasQuirk() ? tmp->Quirks() : "none");
               serversM.Add(tmp);
               }
@@ -297,14 +426,30 @@ void cSatipDiscover::AddServer(const char *srcAddrP, const char *addrP, const in
      FREE_POINTER(p);
      }
   else {
-     cSatipServer *tmp = new cSatipServer(srcAddrP, addrP, portP, modelP, filtersP, descP, quirkP);
+     cSatipServer *tmp = new cSatipServer(srcAddrP, addrP, portP, modelP, filtersP, descP, quirkP, pidLimitP);
      if (!serversM.Update(tmp)) {
+        added = true;
         info("Adding server '%s|%s|%s' Bind: %s Filters: %s CI: %s Quirks: %s", tmp->Address(), tmp->Model(), tmp->Description(), !isempty(tmp->SrcAddress()) ? tmp->SrcAddress() : "default", !isempty(tmp->Filters()) ? tmp->Filters() : "none", tmp->HasCI() ? "yes" : "no", tmp->HasQuirk() ? tmp->Quirks() : "none");
         serversM.Add(tmp);
         }
      else
         DELETENULL(tmp);
      }
+  if (added)
+     ServersChanged();
+}
+
+void cSatipDiscover::ServersChanged(void)
+{
+  cacheDirtyM = true;
+  sourceIndexM.Build(serversM);
+}
+
+void cSatipDiscover::UpdateSourceIndex(void)
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  sourceIndexM.Build(serversM);
 }
 
 int cSatipDiscover::GetServerCount(void)
@@ -370,6 +515,48 @@ void cSatipDiscover::AttachServer(cSatipServer *serverP, int deviceIdP, int tran
   serversM.Attach(serverP, deviceIdP, transponderP);
 }
 
+void cSatipDiscover::AddServerZapTime(cSatipServer *serverP, uint64_t msP)
+{
+  dbg_funcname_ext("%s (, %" PRIu64 ")", __PRETTY_FUNCTION__, msP);
+  cMutexLock MutexLock(&mutexM);
+  serversM.AddZapTime(serverP, msP);
+}
+
+void cSatipDiscover::AddServerSavedRequest(cSatipServer *serverP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  serversM.AddSavedRequest(serverP);
+}
+
+void cSatipDiscover::AddServerError(cSatipServer *serverP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  serversM.AddError(serverP);
+}
+
+void cSatipDiscover::AddServerSuccess(cSatipServer *serverP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  serversM.AddSuccess(serverP);
+}
+
+bool cSatipDiscover::IsServerBlocked(cSatipServer *serverP, int deviceIdP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  return serversM.IsBlocked(serverP, deviceIdP);
+}
+
+bool cSatipDiscover::ProbeServer(cSatipServer *serverP, int deviceIdP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  return serversM.Probe(serverP, deviceIdP);
+}
+
 void cSatipDiscover::DetachServer(cSatipServer *serverP, int deviceIdP, int transponderP)
 {
   dbg_funcname_ext("%s (, %d, %d)", __PRETTY_FUNCTION__, deviceIdP, transponderP);
@@ -391,6 +578,13 @@ bool cSatipDiscover::HasServerCI(cSatipServer *serverP)
   return serversM.HasCI(serverP);
 }
 
+int cSatipDiscover::GetServerPidLimit(cSatipServer *serverP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  return serversM.GetPidLimit(serverP);
+}
+
 cString cSatipDiscover::GetSourceAddress(cSatipServer *serverP)
 {
   dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
@@ -422,8 +616,23 @@ int cSatipDiscover::NumProvidedSystems(void)
 void cSatipDiscover::SetUrl(const char *urlP)
 {
   dbg_funcname_ext("%s (%s)", __PRETTY_FUNCTION__, urlP);
-  mutexM.Lock();
+  cMutexLock MutexLock(&mutexM);
+  // Servers answer each M-SEARCH several times, but one fetch per probe cycle is enough
+  if (isempty(urlP) || (seenUrlListM.Find(urlP) >= 0))
+     return;
+  seenUrlListM.Append(strdup(urlP));
   probeUrlListM.Insert(strdup(urlP));
-  mutexM.Unlock();
   sleepM.Signal();
 }
+
+void cSatipDiscover::RemoveAddress(const char *addressP)
+{
+  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, addressP);
+  cMutexLock MutexLock(&mutexM);
+  // The description is fetched again as soon as the server announces itself
+  seenUrlListM.Clear();
+  if (serversM.CleanupAddress(addressP)) {
+     ServersChanged();
+     sleepM.Signal();
+     }
+}
@@ -23,18 +23,20 @@ class cSatipDiscoverServer : public cListObject {
 private:
   int ipPortM;
   int quirkM;
+  int pidLimitM;
   cString srcAddressM;
   cString ipAddressM;
   cString descriptionM;
   cString modelM;
   cString filtersM;
 public:
-  cSatipDiscoverServer(const char *srcAddressP, const char *ipAddressP, const int ipPortP, const char *modelP, const char *filtersP, const char *descriptionP, const int quirkP)
+  cSatipDiscoverServer(const char *srcAddressP, const char *ipAddressP, const int ipPortP, const char *modelP, const char *filtersP, const char *descriptionP, const int quirkP, const int pidLimitP)
   {
-     srcAddressM = srcAddressP; ipAddressM = ipAddressP; ipPortM = ipPortP; modelM = modelP; filtersM = filtersP; descriptionM = descriptionP; quirkM = quirkP;
+     srcAddressM = srcAddressP; ipAddressM = ipAddressP; ipPortM = ipPortP; modelM = modelP; filtersM = filtersP; descriptionM = descriptionP; quirkM = quirkP; pidLimitM = pidLimitP;
   }
   int IpPort(void)              { return ipPortM; }
   int Quirk(void)               { return quirkM; }
+  int PidLimit(void)            { return pidLimitM; }
   const char *SrcAddress(void)  { return *srcAddressM; }
   const char *IpAddress(void)   { return *ipAddressM; }
   const char *Model(void)       { return *modelM; }
@@ -45,34 +47,63 @@ public:
 class cSatipDiscoverServers : public cList<cSatipDiscoverServer> {
 };
 
+// A single device description request of a probe cycle
+class cSatipDiscoverFetch {
+public:
+  CURL *handleM;
+  cString urlM;
+  cSatipMemoryBuffer headerBufferM;
+  cSatipMemoryBuffer dataBufferM;
+  explicit cSatipDiscoverFetch(const char *urlP) : handleM(curl_easy_init()), urlM(urlP), headerBufferM(), dataBufferM() {}
+  ~cSatipDiscoverFetch() { if (handleM) curl_easy_cleanup(handleM); }
+private:
+  cSatipDiscoverFetch(const cSatipDiscoverFetch&);
+  cSatipDiscoverFetch& operator=(const cSatipDiscoverFetch&);
+};
+
 class cSatipDiscover : public cThread, public cSatipDiscoverIf {
 private:
   enum {
     eSleepTimeoutMs   = 500,   // in milliseconds
+    eFetchWaitMs      = 100,   // in milliseconds
     eConnectTimeoutMs = 1500,  // in milliseconds
     eProbeTimeoutMs   = 2000,  // in milliseconds
     eProbeIntervalMs  = 60000, // in milliseconds
-    eCleanupTimeoutMs = 124000 // in milliseoonds
+    eVerifyTimeoutMs  = 15000, // in milliseconds
+    eCleanupTimeoutMs = 124000, // in milliseoonds
+    // with SSDP announcements the probing is only a fallback
+    eNotifyProbeIntervalMs  = 300000, // in milliseconds
+    eNotifyCleanupTimeoutMs = 604000, // in milliseconds
+    eNotifyTimeoutMs        = 600000  // in milliseconds, no announcements within two probe intervals
   };
   static cSatipDiscover *instanceS;
   static size_t HeaderCallback(char *ptrP, size_t sizeP, size_t nmembP, void *dataP);
   static size_t DataCallback(char *ptrP, size_t sizeP, size_t nmembP, void *dataP);
   static int    DebugCallback(CURL *handleP, curl_infotype typeP, char *dataP, size_t sizeP, void *userPtrP);
   cMutex mutexM;
-  cSatipMemoryBuffer headerBufferM;
-  cSatipMemoryBuffer dataBufferM;
   cSatipMsearch msearchM;
   cStringList probeUrlListM;
-  CURL *handleM;
+  cStringList seenUrlListM;
+  CURLM *multiM;
   cCondWait sleepM;
   cTimeMs probeIntervalM;
+  cTimeMs verifyTimeoutM;
   cSatipServers serversM;
+  cSatipSourceIndex sourceIndexM;
+  cString cacheFileM;
+  bool cacheDirtyM;
+  bool unverifiedM;
   void Activate(void);
   void Deactivate(void);
-  int ParseRtspPort(void);
-  void ParseDeviceInfo(const char *addrP, const int portP);
-  void AddServer(const char *srcAddrP, const char *addrP, const int portP, const char *modelP, const char *filtersP, const char *descP, const int quirkP);
-  void Fetch(const char *urlP);
+  int ParseRtspPort(cSatipDiscoverFetch &fetchP);
+  void ParseDeviceInfo(cSatipDiscoverFetch &fetchP, const char *addrP, const int portP);
+  void AddServer(const char *srcAddrP, const char *addrP, const int portP, const char *modelP, const char *filtersP, const char *descP, const int quirkP, const int pidLimitP);
+  bool Prepare(cSatipDiscoverFetch &fetchP);
+  void Complete(cSatipDiscoverFetch &fetchP, CURLcode resultP);
+  void Fetch(cStringList &urlsP);
+  void ServersChanged(void);
+  void LoadCache(void);
+  void SaveCache(void);
   // constructor
   cSatipDiscover();
   // to prevent copy constructor and assignment
@@ -84,11 +115,13 @@ protected:
 
 public:
   static cSatipDiscover *GetInstance(void);
-  static bool Initialize(cSatipDiscoverServers *serversP);
+  static bool Initialize(cSatipDiscoverServers *serversP, const char *configDirP = NULL);
   static void Destroy(void);
   virtual ~cSatipDiscover();
   void TriggerScan(void) { probeIntervalM.Set(0); }
   int GetServerCount(void);
+  bool ProvidesSource(int sourceP) const { return sourceIndexM.Provides(sourceP); }
+  void UpdateSourceIndex(void);
   cSatipServer *AssignServer(int deviceIdP, int sourceP, int transponderP, int systemP);
   cSatipServer *GetServer(int sourceP);
   cSatipServer *GetServer(cSatipServer *serverP);
@@ -97,8 +130,15 @@ public:
   void ActivateServer(cSatipServer *serverP, bool onOffP);
   void AttachServer(cSatipServer *serverP, int deviceIdP, int transponderP);
   void DetachServer(cSatipServer *serverP, int deviceIdP, int transponderP);
+  void AddServerZapTime(cSatipServer *serverP, uint64_t msP);
+  void AddServerSavedRequest(cSatipServer *serverP);
+  void AddServerError(cSatipServer *serverP);
+  void AddServerSuccess(cSatipServer *serverP);
+  bool IsServerBlocked(cSatipServer *serverP, int deviceIdP);
+  bool ProbeServer(cSatipServer *serverP, int deviceIdP);
   bool IsServerQuirk(cSatipServer *serverP, int quirkP);
   bool HasServerCI(cSatipServer *serverP);
+  int GetServerPidLimit(cSatipServer *serverP);
   cString GetServerAddress(cSatipServer *serverP);
   cString GetSourceAddress(cSatipServer *serverP);
   int GetServerPort(cSatipServer *serverP);
@@ -108,6 +148,7 @@ public:
   // for internal discover interface
 public:
   virtual void SetUrl(const char *urlP);
+  virtual void RemoveAddress(const char *addressP);
 };
 
 #endif // __SATIP_DISCOVER_H
@@ -13,6 +13,7 @@ public:
   cSatipDiscoverIf() {}
   virtual ~cSatipDiscoverIf() {}
   virtual void SetUrl(const char *urlP) = 0;
+  virtual void RemoveAddress(const char *addressP) = 0;
 
 private:
   explicit cSatipDiscoverIf(const cSatipDiscoverIf&);
@@ -5,6 +5,8 @@
  *
  */
 
+#include <sys/timerfd.h>
+
 #include "config.h"
 #include "common.h"
 #include "discover.h"
@@ -17,20 +19,159 @@ const char *cSatipMsearch::bcastMessageS = "M-SEARCH * HTTP/1.1\r\n"
                                            "HOST: 239.255.255.250:1900\r\n"           \
                                            "MAN: \"ssdp:discover\"\r\n"               \
                                            "ST: urn:ses-com:device:SatIPServer:1\r\n" \
-                                           "MX: 2\r\n\r\n";
+                                           "MX: %d\r\n\r\n";
+
+// --- cSatipMsearchNotify ----------------------------------------------------
+
+cSatipMsearchNotify::cSatipMsearchNotify(cSatipDiscoverIf &discoverP)
+: discoverM(discoverP),
+  bufferLenM(eNotifyBufferSize),
+  bufferM(MALLOC(unsigned char, bufferLenM)),
+  lastNotifyM(0)
+{
+  if (bufferM)
+     memset(bufferM, 0, bufferLenM);
+  else
+     error("Cannot create Msearch notify buffer!");
+}
+
+cSatipMsearchNotify::~cSatipMsearchNotify()
+{
+  FREE_POINTER(bufferM);
+}
+
+int cSatipMsearchNotify::GetFd(void)
+{
+  return Fd();
+}
+
+void cSatipMsearchNotify::Process(void)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  if (bufferM) {
+     int length;
+     in_addr_t srcAddr = htonl(INADDR_ANY);
+     while ((length = Read(bufferM, bufferLenM, &srcAddr)) > 0) {
+           bufferM[min(length, int(bufferLenM - 1))] = 0;
+           dbg_msearch("%s len=%d buf=%s", __PRETTY_FUNCTION__, length, bufferM);
+           // NOTIFY * HTTP/1.1
+           if ((length < 6) || strncmp(reinterpret_cast<const char *>(bufferM), "NOTIFY", 6))
+              continue;
+           bool valid = false, alive = false, byebye = false;
+           char location[256] = "";
+           cSatipHeader header(reinterpret_cast<const char *>(bufferM), length);
+           while (header.Next()) {
+                 // NT: urn:ses-com:device:SatIPServer:1
+                 if (header.Is("NT")) {
+                    static const char satipServer[] = "urn:ses-com:device:SatIPServer:1";
+                    if (memmem(header.Value(), header.ValueLength(), satipServer, sizeof(satipServer) - 1))
+                       valid = true;
+                    }
+                 // NTS: ssdp:alive
+                 else if (header.Is("NTS")) {
+                    alive = cSatipHeader::HasToken(header.Value(), header.ValueLength(), "ssdp:alive");
+                    byebye = cSatipHeader::HasToken(header.Value(), header.ValueLength(), "ssdp:byebye");
+                    }
+                 // LOCATION: http://192.168.0.115:8888/octonet.xml
+                 else if (header.Is("LOCATION"))
+                    header.CopyValue(location, sizeof(location));
+                 }
+           if (!valid)
+              continue;
+           lastNotifyM = cTimeMs::Now();
+           dbg_funcname("%s %s location='%s'", __PRETTY_FUNCTION__, alive ? "alive" : byebye ? "byebye" : "unknown", location);
+           if (alive && !isempty(location))
+              discoverM.SetUrl(location);
+           else if (byebye) {
+              char address[INET_ADDRSTRLEN];
+              struct in_addr addr;
+              addr.s_addr = srcAddr;
+              if (inet_ntop(AF_INET, &addr, address, sizeof(address)))
+                 discoverM.RemoveAddress(address);
+              }
+           }
+     }
+}
+
+void cSatipMsearchNotify::Process(unsigned char *dataP, int lengthP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+}
+
+cString cSatipMsearchNotify::ToString(void) const
+{
+  return "MSearch notify";
+}
+
+// --- cSatipMsearchTimer -----------------------------------------------------
+
+cSatipMsearchTimer::cSatipMsearchTimer(cSatipMsearch &msearchP)
+: msearchM(msearchP),
+  fdM(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+{
+  ERROR_IF(fdM < 0, "timerfd_create()");
+}
+
+cSatipMsearchTimer::~cSatipMsearchTimer()
+{
+  if (fdM >= 0)
+     close(fdM);
+}
+
+bool cSatipMsearchTimer::Arm(int msP)
+{
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = msP / 1000;
+  spec.it_value.tv_nsec = (msP % 1000) * 1000000L;
+  ERROR_IF_RET(timerfd_settime(fdM, 0, &spec, NULL) < 0, "timerfd_settime()", return false);
+  return true;
+}
+
+int cSatipMsearchTimer::GetFd(void)
+{
+  return fdM;
+}
+
+void cSatipMsearchTimer::Process(void)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  uint64_t expirations;
+  if (read(fdM, &expirations, sizeof(expirations)) == sizeof(expirations))
+     msearchM.Transmit();
+}
+
+void cSatipMsearchTimer::Process(unsigned char *dataP, int lengthP)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+}
+
+cString cSatipMsearchTimer::ToString(void) const
+{
+  return "MSearch timer";
+}
+
+// --- cSatipMsearch ----------------------------------------------------------
 
 cSatipMsearch::cSatipMsearch(cSatipDiscoverIf &discoverP)
 : discoverM(discoverP),
+  notifyM(discoverP),
+  timerM(*this),
+  mutexM(),
   bufferLenM(eProbeBufferSize),
   bufferM(MALLOC(unsigned char, bufferLenM)),
-  registeredM(false)
+  registeredM(false),
+  pendingM(0)
 {
   if (bufferM)
      memset(bufferM, 0, bufferLenM);
   else
      error("Cannot create Msearch buffer!");
-  if (!Open(eDiscoveryPort, true))
+  // The responses are sent to our own port, so only the announcements use the discovery port
+  if (!Open())
      error("Cannot open Msearch port!");
+  if (!notifyM.OpenMulticast(eDiscoveryPort, bcastAddressS, NULL))
+     error("Cannot join SSDP multicast group, relying on M-SEARCH only!");
 }
 
 cSatipMsearch::~cSatipMsearch()
@@ -41,14 +182,32 @@ cSatipMsearch::~cSatipMsearch()
 void cSatipMsearch::Probe(void)
 {
   dbg_funcname("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
   if (!registeredM) {
      cSatipPoller::GetInstance()->Register(*this);
+     if (notifyM.IsMulticast())
+        cSatipPoller::GetInstance()->Register(notifyM);
+     if (timerM.IsOpen())
+        cSatipPoller::GetInstance()->Register(timerM);
      registeredM = true;
      }
-  // Send two queries with one second interval
-  Write(bcastAddressS, reinterpret_cast<const unsigned char *>(bcastMessageS), strlen(bcastMessageS));
-  cCondWait::SleepMs(1000);
-  Write(bcastAddressS, reinterpret_cast<const unsigned char *>(bcastMessageS), strlen(bcastMessageS));
+  // Only the first query is sent here, the poller takes care of the retransmissions
+  pendingM = max(1, (int)SatipConfig.GetMsearchCount());
+  Transmit();
+}
+
+void cSatipMsearch::Transmit(void)
+{
+  cMutexLock MutexLock(&mutexM);
+  if (pendingM <= 0)
+     return;
+  char message[eProbeBufferSize];
+  int length = snprintf(message, sizeof(message), bcastMessageS, max(1, (int)SatipConfig.GetMsearchMx()));
+  dbg_funcname("%s (%d left)", __PRETTY_FUNCTION__, pendingM - 1);
+  Write(bcastAddressS, reinterpret_cast<const unsigned char *>(message), length, eDiscoveryPort);
+  // Without a timer a single query has to do
+  if ((--pendingM > 0) && (!timerM.IsOpen() || !timerM.Arm(eRetransmitIntervalMs)))
+     pendingM = 0;
 }
 
 int cSatipMsearch::GetFd(void)
@@ -65,28 +224,28 @@ void cSatipMsearch::Process(void)
            bufferM[min(length, int(bufferLenM - 1))] = 0;
            dbg_msearch("%s len=%d buf=%s", __PRETTY_FUNCTION__, length, bufferM);
            bool status = false, valid = false;
-           char *s, *p = reinterpret_cast<char *>(bufferM), *location = NULL;
-           char *r = strtok_r(p, "\r\n", &s);
-           while (r) {
-                 dbg_msearch("%s r=%s", __PRETTY_FUNCTION__, r);
+           char location[256] = "";
+           cSatipHeader header(reinterpret_cast<const char *>(bufferM), length);
+           while (header.Next()) {
+                 dbg_msearch("%s r=%.*s", __PRETTY_FUNCTION__, (int)header.LineLength(), header.Line());
                  // Check the status code
                  // HTTP/1.1 200 OK
-                 if (!status && startswith(r, "HTTP/1.1 200 OK"))
+                 if (!status && (header.LineLength() >= 15) && !strncmp(header.Line(), "HTTP/1.1 200 OK", 15))
                     status = true;
                  if (status) {
                     // Check the location data
                     // LOCATION: http://192.168.0.115:8888/octonet.xml
-                    if (strcasestr(r, "LOCATION:") == r) {
-                       location = compactspace(r + 9);
+                    if (header.Is("LOCATION")) {
+                       header.CopyValue(location, sizeof(location));
                        dbg_funcname("%s location='%s'", __PRETTY_FUNCTION__, location);
                        }
                     // Check the source type
                     // ST: urn:ses-com:device:SatIPServer:1
-                    else if (strcasestr(r, "ST:") == r) {
-                       char *st = compactspace(r + 3);
-                       if (strstr(st, "urn:ses-com:device:SatIPServer:1"))
+                    else if (header.Is("ST")) {
+                       static const char satipServer[] = "urn:ses-com:device:SatIPServer:1";
+                       if (memmem(header.Value(), header.ValueLength(), satipServer, sizeof(satipServer) - 1))
                           valid = true;
-                       dbg_funcname("%s st='%s'", __PRETTY_FUNCTION__, st);
+                       dbg_funcname("%s st='%.*s'", __PRETTY_FUNCTION__, (int)header.ValueLength(), header.Value());
                        }
                     // Check whether all the required data is found
                     if (valid && !isempty(location)) {
@@ -94,7 +253,6 @@ void cSatipMsearch::Process(void)
                        break;
                        }
                     }
-                 r = strtok_r(NULL, "\r\n", &s);
                  }
            }
      }
@@ -8,27 +8,84 @@
 #ifndef __SATIP_MSEARCH_H_
 #define __SATIP_MSEARCH_H_
 
+#include <atomic>
+#include <stdint.h>
+
 #include "discoverif.h"
 #include "socket.h"
 #include "pollerif.h"
 
+// Listens to the SSDP multicast group for the NOTIFY announcements of servers
+class cSatipMsearchNotify : public cSatipSocket, public cSatipPollerIf {
+private:
+  enum {
+    eNotifyBufferSize = 1024 // in bytes
+  };
+  cSatipDiscoverIf &discoverM;
+  unsigned int bufferLenM;
+  unsigned char *bufferM;
+  std::atomic<uint64_t> lastNotifyM;
+
+public:
+  explicit cSatipMsearchNotify(cSatipDiscoverIf &discoverP);
+  virtual ~cSatipMsearchNotify();
+  bool IsReceiving(uint64_t timeoutMsP) { uint64_t last = lastNotifyM; return last && (cTimeMs::Now() - last < timeoutMsP); }
+
+  // for internal poller interface
+public:
+  virtual int GetFd(void);
+  virtual void Process(void);
+  virtual void Process(unsigned char *dataP, int lengthP);
+  virtual cString ToString(void) const;
+};
+
+class cSatipMsearch;
+
+// Fires the retransmissions of the M-SEARCH queries in the poller thread
+class cSatipMsearchTimer : public cSatipPollerIf {
+private:
+  cSatipMsearch &msearchM;
+  int fdM;
+
+public:
+  explicit cSatipMsearchTimer(cSatipMsearch &msearchP);
+  virtual ~cSatipMsearchTimer();
+  bool IsOpen(void) { return (fdM >= 0); }
+  bool Arm(int msP);
+
+  // for internal poller interface
+public:
+  virtual int GetFd(void);
+  virtual void Process(void);
+  virtual void Process(unsigned char *dataP, int lengthP);
+  virtual cString ToString(void) const;
+};
+
 class cSatipMsearch : public cSatipSocket, public cSatipPollerIf {
 private:
   enum {
-    eProbeBufferSize  = 1024, // in bytes
-    eDiscoveryPort    = 1900,
+    eProbeBufferSize      = 1024, // in bytes
+    eDiscoveryPort        = 1900,
+    eRetransmitIntervalMs = 1000  // in milliseconds
   };
   static const char *bcastAddressS;
   static const char *bcastMessageS;
   cSatipDiscoverIf &discoverM;
+  cSatipMsearchNotify notifyM;
+  cSatipMsearchTimer timerM;
+  cMutex mutexM;
   unsigned int bufferLenM;
   unsigned char *bufferM;
   bool registeredM;
+  int pendingM;
 
 public:
   explicit cSatipMsearch(cSatipDiscoverIf &discoverP);
   virtual ~cSatipMsearch();
   void Probe(void);
+  void Transmit(void);
+  // Joining the group alone doesn't tell whether any announcements get through
+  bool IsListening(uint64_t timeoutMsP) { return registeredM && notifyM.IsMulticast() && notifyM.IsReceiving(timeoutMsP); }
 
   // for internal poller interface
 public:
@@ -0,0 +1,203 @@
+/*
+ * multicast.c: SAT>IP plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include "config.h"
+#include "common.h"
+#include "log.h"
+#include "poller.h"
+#include "multicast.h"
+
+// --- cSatipMulticastGroup ---------------------------------------------------
+
+cSatipMulticastGroup::cSatipMulticastGroup()
+: cSatipSocket(SatipConfig.GetRtpRcvBufSize()),
+  mutexM(),
+  portM(0),
+  addressM(""),
+  sourceM(""),
+  subscribersM(),
+  bufferLenM(ePacketReadCount * eMaxUdpPacketSizeB),
+  bufferM(MALLOC(unsigned char, bufferLenM))
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  if (!bufferM)
+     error("Cannot create multicast buffer!");
+}
+
+cSatipMulticastGroup::~cSatipMulticastGroup()
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  Close();
+  FREE_POINTER(bufferM);
+}
+
+bool cSatipMulticastGroup::Open(const int portP, const char *addressP, const char *sourceP)
+{
+  dbg_funcname("%s (%d, %s, %s)", __PRETTY_FUNCTION__, portP, addressP, sourceP);
+  if (!OpenMulticast(portP, addressP, sourceP)) {
+     Close();
+     return false;
+     }
+  portM = portP;
+  addressM = addressP;
+  sourceM = isempty(sourceP) ? "" : sourceP;
+  if (!cSatipPoller::GetInstance()->Register(*this)) {
+     Close();
+     return false;
+     }
+  return true;
+}
+
+void cSatipMulticastGroup::Close(void)
+{
+  cMutexLock MutexLock(&mutexM);
+  if (IsOpen()) {
+     dbg_funcname("%s (%d, %s, %s)", __PRETTY_FUNCTION__, portM, *addressM, *sourceM);
+     cSatipPoller::GetInstance()->Unregister(*this);
+     }
+  cSatipSocket::Close();
+}
+
+bool cSatipMulticastGroup::Is(const int portP, const char *addressP, const char *sourceP)
+{
+  return IsOpen() && (portM == portP) && !strcmp(*addressM, addressP) && !strcmp(*sourceM, isempty(sourceP) ? "" : sourceP);
+}
+
+void cSatipMulticastGroup::Subscribe(cSatipPollerIf *subscriberP)
+{
+  cMutexLock MutexLock(&mutexM);
+  subscribersM.AppendUnique(subscriberP);
+}
+
+void cSatipMulticastGroup::Unsubscribe(cSatipPollerIf *subscriberP)
+{
+  // No callbacks into the subscriber once this returns
+  cMutexLock MutexLock(&mutexM);
+  subscribersM.RemoveElement(subscriberP);
+}
+
+int cSatipMulticastGroup::GetFd(void)
+{
+  return Fd();
+}
+
+void cSatipMulticastGroup::Process(void)
+{
+  dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  if (bufferM && IsOpen()) {
+     unsigned int lenMsg[ePacketReadCount];
+     int count = 0;
+
+     do {
+       count = ReadMulti(bufferM, lenMsg, ePacketReadCount, eMaxUdpPacketSizeB);
+       for (int i = 0; i < count; ++i) {
+           unsigned char *p = &bufferM[i * eMaxUdpPacketSizeB];
+           for (int j = 0; j < subscribersM.Size(); ++j)
+               subscribersM[j]->Process(p, lenMsg[i]);
+           }
+       } while (count >= ePacketReadCount);
+     }
+}
+
+void cSatipMulticastGroup::Process(unsigned char *dataP, int lengthP)
+{
+}
+
+cString cSatipMulticastGroup::ToString(void) const
+{
+  return cString::sprintf("Multicast %s:%d", *addressM, portM);
+}
+
+// --- cSatipMulticast --------------------------------------------------------
+
+cSatipMulticast *cSatipMulticast::instanceS = NULL;
+
+cSatipMulticast *cSatipMulticast::GetInstance(void)
+{
+  if (!instanceS)
+     instanceS = new cSatipMulticast();
+  return instanceS;
+}
+
+void cSatipMulticast::Destroy(void)
+{
+  DELETE_POINTER(instanceS);
+}
+
+cSatipMulticast::cSatipMulticast()
+: mutexM(),
+  groupsM()
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+}
+
+cSatipMulticast::~cSatipMulticast()
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  cMutexLock MutexLock(&mutexM);
+  for (int i = 0; i < groupsM.Size(); ++i)
+      delete groupsM[i];
+  groupsM.Clear();
+}
+
+bool cSatipMulticast::Subscribe(cSatipPollerIf &subscriberP, const int portP, const char *addressP, const char *sourceP)
+{
+  dbg_funcname("%s (%s, %d, %s, %s)", __PRETTY_FUNCTION__, *subscriberP.ToString(), portP, addressP, sourceP);
+  if ((portP <= 0) || isempty(addressP))
+     return false;
+  cMutexLock MutexLock(&mutexM);
+  for (int i = 0; i < groupsM.Size(); ++i) {
+      if (groupsM[i]->HasSubscriber(&subscriberP)) {
+         if (groupsM[i]->Is(portP, addressP, sourceP))
+            return true;
+         break;
+         }
+      }
+  Unsubscribe(subscriberP);
+  cSatipMulticastGroup *group = NULL;
+  cSatipMulticastGroup *unused = NULL;
+  for (int i = 0; i < groupsM.Size(); ++i) {
+      if (groupsM[i]->Is(portP, addressP, sourceP)) {
+         group = groupsM[i];
+         break;
+         }
+      if (!unused && !groupsM[i]->IsOpen())
+         unused = groupsM[i];
+      }
+  if (!group) {
+     // Groups are never deleted as the poller might still hold a pending event for them
+     if (!unused) {
+        unused = new cSatipMulticastGroup();
+        groupsM.Append(unused);
+        }
+     if (!unused->Open(portP, addressP, sourceP)) {
+        error("Cannot join multicast group %s:%d", addressP, portP);
+        return false;
+        }
+     group = unused;
+     }
+  group->Subscribe(&subscriberP);
+  dbg_funcname("%s %s has %d subscriber(s)", __PRETTY_FUNCTION__, *group->ToString(), group->Subscribers());
+  return true;
+}
+
+void cSatipMulticast::Unsubscribe(cSatipPollerIf &subscriberP)
+{
+  cMutexLock MutexLock(&mutexM);
+  for (int i = 0; i < groupsM.Size(); ++i) {
+      cSatipMulticastGroup *group = groupsM[i];
+      if (group->HasSubscriber(&subscriberP)) {
+         dbg_funcname("%s (%s) %s", __PRETTY_FUNCTION__, *subscriberP.ToString(), *group->ToString());
+         group->Unsubscribe(&subscriberP);
+         // The last subscriber leaves the group
+         if (!group->Subscribers())
+            group->Close();
+         break;
+         }
+      }
+}
@@ -0,0 +1,77 @@
+/*
+ * multicast.h: SAT>IP plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __SATIP_MULTICAST_H
+#define __SATIP_MULTICAST_H
+
+#include <vdr/thread.h>
+#include <vdr/tools.h>
+
+#include "common.h"
+#include "pollerif.h"
+#include "socket.h"
+
+// A single socket joined to a multicast group. The received datagrams are
+// handed to all subscribers straight from the receive buffer.
+class cSatipMulticastGroup : public cSatipSocket, public cSatipPollerIf {
+private:
+  enum {
+    ePacketReadCount   = 50,
+    eMaxUdpPacketSizeB = 1500
+  };
+  cMutex mutexM;
+  int portM;
+  cString addressM;
+  cString sourceM;
+  cVector<cSatipPollerIf *> subscribersM;
+  unsigned int bufferLenM;
+  unsigned char *bufferM;
+
+  // to prevent copy constructor and assignment
+  cSatipMulticastGroup(const cSatipMulticastGroup&);
+  cSatipMulticastGroup& operator=(const cSatipMulticastGroup&);
+
+public:
+  cSatipMulticastGroup();
+  virtual ~cSatipMulticastGroup();
+  bool Open(const int portP, const char *addressP, const char *sourceP);
+  virtual void Close(void);
+  bool Is(const int portP, const char *addressP, const char *sourceP);
+  bool HasSubscriber(cSatipPollerIf *subscriberP) const { return (subscribersM.IndexOf(subscriberP) >= 0); }
+  int Subscribers(void) const { return subscribersM.Size(); }
+  void Subscribe(cSatipPollerIf *subscriberP);
+  void Unsubscribe(cSatipPollerIf *subscriberP);
+
+  // for internal poller interface
+public:
+  virtual int GetFd(void);
+  virtual void Process(void);
+  virtual void Process(unsigned char *dataP, int lengthP);
+  virtual cString ToString(void) const;
+};
+
+// Reference counts the multicast groups of all tuners, so each (group, port,
+// source) is joined only once regardless of the number of receivers.
+class cSatipMulticast {
+private:
+  static cSatipMulticast *instanceS;
+  cMutex mutexM;
+  cVector<cSatipMulticastGroup *> groupsM;
+  cSatipMulticast();
+  // to prevent copy constructor and assignment
+  cSatipMulticast(const cSatipMulticast&);
+  cSatipMulticast& operator=(const cSatipMulticast&);
+
+public:
+  static cSatipMulticast *GetInstance(void);
+  static void Destroy(void);
+  virtual ~cSatipMulticast();
+  bool Subscribe(cSatipPollerIf &subscriberP, const int portP, const char *addressP, const char *sourceP);
+  void Unsubscribe(cSatipPollerIf &subscriberP);
+};
+
+#endif // __SATIP_MULTICAST_H
@@ -7,6 +7,7 @@
 
 #include <sstream>   // std::stringstream
 #include <ctype.h>
+#include <string.h>
 #include <vdr/dvbdevice.h>
 #include "common.h"
 #include "param.h"
@@ -160,6 +161,217 @@ int SatipToVdrParameter(std::string param) {
   return 999;
 }
 
+int SatipToVdrParameter(const char *keyP, const char *valueP, size_t lengthP) {
+  const tSatipParameterMap* map = nullptr;
+
+  if (!strcmp(keyP, "bw"))
+     map = SatipBandwidthValues;
+  else if (!strcmp(keyP, "plts"))
+     map = SatipPilotValues;
+  else if (!strcmp(keyP, "sm"))
+     map = SatipSisoMisoValues;
+  else if (!strcmp(keyP, "fec"))
+     map = SatipCodeRateValues;
+  else if (!strcmp(keyP, "mtype"))
+     map = SatipModulationValues;
+  else if (!strcmp(keyP, "msys") && (lengthP >= 4) && !strncmp(valueP, "dvbs", 4))
+     map = SatipSystemValuesSat;
+  else if (!strcmp(keyP, "msys") && (lengthP >= 4) && !strncmp(valueP, "dvbt", 4))
+     map = SatipSystemValuesTerrestrial;
+  else if (!strcmp(keyP, "msys") && (lengthP >= 4) && !strncmp(valueP, "dvbc", 4))
+     map = SatipSystemValuesCable;
+  else if (!strcmp(keyP, "msys") && (lengthP >= 4) && !strncmp(valueP, "atsc", 4))
+     map = SatipSystemValuesAtsc;
+  else if (!strcmp(keyP, "tmode"))
+     map = SatipTransmissionValues;
+  else if (!strcmp(keyP, "gi"))
+     map = SatipGuardValues;
+  else if (!strcmp(keyP, "ro"))
+     map = SatipRollOffValues;
+  else if (!strcmp(keyP, "specinv"))
+     map = SatipInversionValues;
+
+  // The map strings are "&<key>=<value>"
+  size_t offset = strlen(keyP) + 2;
+  auto it = map;
+  while(it && it->satipString) {
+     const char *s = it->satipString;
+     if (*s && (strlen(s) == offset + lengthP) && !strncmp(s + offset, valueP, lengthP))
+        return it->vdrValue;
+     it++;
+     }
+  return 999;
+}
+
+// Parses a bounded decimal number, optionally rounding a fractional part
+static int ParseNumber(const char *p, size_t len, int defaultP) {
+  const char *end = p + len;
+  bool negative = false;
+  int value = 0;
+
+  if (!len)
+     return defaultP;
+  if (*p == '-') {
+     negative = true;
+     ++p;
+     }
+  if ((p >= end) || !isdigit(*p))
+     return defaultP;
+  while ((p < end) && isdigit(*p))
+     value = value * 10 + (*p++ - '0');
+  if ((p + 1 < end) && (*p == '.') && isdigit(p[1]) && (p[1] >= '5'))
+     ++value;
+  return negative ? -value : value;
+}
+
+bool SatipParseReceptionStatus(const char *bufferP, size_t lengthP, tSatipReceptionStatus *statusP) {
+  static const char ver[] = "ver=";
+  const char *end = bufferP + lengthP;
+  const char *p = (const char *)memmem(bufferP, lengthP, ver, sizeof(ver) - 1);
+
+  if (!p)
+     return false;
+
+  // The status ends at the end of the line in DESCRIBE responses
+  for (const char *e = p; e < end; ++e) {
+      if ((*e == '\r') || (*e == '\n') || !*e) {
+         end = e;
+         break;
+         }
+      }
+
+  statusP->system = 0;
+  statusP->srcId = -1;
+  statusP->frontendId = -1;
+  statusP->level = -1;
+  statusP->lock = false;
+  statusP->quality = -1;
+  statusP->transponder = nullptr;
+  statusP->transponderLength = 0;
+  statusP->fieldCount = 0;
+
+  // DVB-S2: ver=1.0;src=<srcID>;(..)
+  // DVB-T2: ver=1.1;(..)
+  // DVB-C2: ver=1.2;(..)
+  bool tuner = false;
+  while (p < end) {
+     const char *sep = (const char *)memchr(p, ';', end - p);
+     const char *next = sep ? sep : end;
+     size_t len = next - p;
+     if ((len == 7) && !strncmp(p, "ver=1.", 6))
+        statusP->system = (p[6] == '0') ? 'S' : (p[6] == '1') ? 'T' : (p[6] == '2') ? 'C' : 0;
+     else if ((len > 4) && !strncmp(p, "src=", 4))
+        statusP->srcId = ParseNumber(p + 4, len - 4, -1);
+     else if ((len > 6) && !strncmp(p, "tuner=", 6)) {
+        // tuner=<feID>,<level>,<lock>,<quality>,(..)
+        const char *f = p + 6;
+        for (int i = 0; (i < 4) && (f <= next); ++i) {
+            const char *comma = (const char *)memchr(f, ',', next - f);
+            const char *fieldEnd = comma ? comma : next;
+            int value = ParseNumber(f, fieldEnd - f, -1);
+            switch (i) {
+              case 0: statusP->frontendId = value; break;
+              case 1: statusP->level = value; break;
+              case 2: statusP->lock = (value == 1); break;
+              case 3: statusP->quality = value; break;
+              }
+            f = fieldEnd + 1;
+            }
+        if (f < next) {
+           statusP->transponder = f;
+           statusP->transponderLength = next - f;
+           }
+        tuner = true;
+        break;
+        }
+     p = next + 1;
+     }
+
+  return tuner;
+}
+
+bool SatipToVdrTransponder(tSatipReceptionStatus *statusP, const cChannel *channelP, int *sourceP, int *frequencyP, int *symbolRateP, char *parametersP, size_t sizeP) {
+  if (!statusP->transponder || !statusP->system || !sizeP)
+     return false;
+
+  // Split the transponder parameters into the field table
+  const char *p = statusP->transponder;
+  const char *end = p + statusP->transponderLength;
+  statusP->fieldCount = 0;
+  while ((p <= end) && (statusP->fieldCount < tSatipReceptionStatus::eMaxFields)) {
+     const char *comma = (const char *)memchr(p, ',', end - p);
+     const char *fieldEnd = comma ? comma : end;
+     statusP->field[statusP->fieldCount] = p;
+     statusP->fieldLength[statusP->fieldCount] = fieldEnd - p;
+     statusP->fieldCount++;
+     p = fieldEnd + 1;
+     }
+  for (int i = statusP->fieldCount; i < tSatipReceptionStatus::eMaxFields; ++i) {
+      statusP->field[i] = "";
+      statusP->fieldLength[i] = 0;
+      }
+
+  #define FIELD(n) statusP->field[n], statusP->fieldLength[n]
+  int len = 0;
+  *parametersP = 0;
+  if (statusP->system == 'S') {
+     // <frequency>,<polarisation>,<system>,<type>,<pilots>,<roll_off>,<symbol_rate>,<fec_inner>
+     int  System     = SatipToVdrParameter("msys", FIELD(2));
+     int  Type       = SatipToVdrParameter("mtype", FIELD(3));
+     int  Pilots     = SatipToVdrParameter("plts", FIELD(4));
+     int  RollOff    = SatipToVdrParameter("ro", FIELD(5));
+     int  SymbolRate = ParseNumber(FIELD(6), 0);
+     int  Fec        = SatipToVdrParameter("fec", FIELD(7));
+     int  Source     = SrcIdToSource(statusP->srcId);
+     char Polarisation[2] = { 0, 0 };
+     if (statusP->fieldLength[1])
+        Polarisation[0] = (char)toupper(*statusP->field[1]);
+
+     *sourceP = (Source < 0) ? channelP->Source() : Source;
+     *frequencyP = ParseNumber(FIELD(0), 0);
+     *symbolRateP = (SymbolRate <= 0) ? channelP->Srate() : SymbolRate;
+     if (System > 0)
+        len = snprintf(parametersP, sizeP, "%sC%dM%dN%dO%dS%d", Polarisation, Fec, Type, Pilots, RollOff, System);
+     else
+        len = snprintf(parametersP, sizeP, "%sC%dM%dS%d", Polarisation, Fec, Type, System);
+     }
+  else if (statusP->system == 'T') {
+     // <freq>,<bw>,<msys>,<tmode>,<mtype>,<gi>,<fec>,<plp>,<t2id>,<sm>
+     int BandWidth    = SatipToVdrParameter("bw", FIELD(1));
+     int System       = SatipToVdrParameter("msys", FIELD(2));
+     int Transmission = SatipToVdrParameter("tmode", FIELD(3));
+     int Type         = SatipToVdrParameter("mtype", FIELD(4));
+     int Guard        = SatipToVdrParameter("gi", FIELD(5));
+     int Fec          = SatipToVdrParameter("fec", FIELD(6));
+     int Plp          = ParseNumber(FIELD(7), -1);
+     int T2id         = ParseNumber(FIELD(8), -1);
+     int SM           = SatipToVdrParameter("sm", FIELD(9));
+
+     *sourceP = 'T' << 24;
+     *frequencyP = ParseNumber(FIELD(0), 0);
+     *symbolRateP = 0;
+     if (System > 0)
+        len = snprintf(parametersP, sizeP, "B%dC%dG%dM%dP%dQ%dS%dT%dX%d", BandWidth, Fec, Guard, Type, Plp, T2id, System, Transmission, SM);
+     else
+        len = snprintf(parametersP, sizeP, "B%dC%dG%dM%dS%dT%d", BandWidth, Fec, Guard, Type, System, Transmission);
+     }
+  else if (statusP->system == 'C') {
+     // <freq>,<bw>,<msys>,<mtype>,<sr>,<c2tft>,<ds>,<plp>,<specinv>
+     // not used in VDR: BandWidth, System, C2tft, DS, Plp
+     int Type       = SatipToVdrParameter("mtype", FIELD(3));
+     int SymbolRate = ParseNumber(FIELD(4), 0);
+     int Inversion  = ParseNumber(FIELD(8), 999);
+
+     *sourceP = 'C' << 24;
+     *frequencyP = ParseNumber(FIELD(0), 0);
+     *symbolRateP = (SymbolRate <= 0) ? channelP->Srate() : SymbolRate;
+     len = snprintf(parametersP, sizeP, "I%dM%d", Inversion, Type);
+     }
+  #undef FIELD
+
+  return (len > 0) && ((size_t)len < sizeP);
+}
+
 std::string GetTransponderUrlParameters(const cChannel* channel) {
   std::string result;
 
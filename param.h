@@ -12,4 +12,26 @@
 std::string GetTransponderUrlParameters(const cChannel* channel);
 std::string GetTnrUrlParameters(const cChannel* channel);
 int SatipToVdrParameter(std::string param);
+int SatipToVdrParameter(const char *keyP, const char *valueP, size_t lengthP);
 int SrcIdToSource(int pos);
+
+// Reception status of RTCP APP packets and DESCRIBE responses:
+// ver=<major>.<minor>;[src=<srcID>;]tuner=<feID>,<level>,<lock>,<quality>,<transponder parameters>;...
+// The transponder parameters aren't copied, but refer to the parsed buffer.
+struct tSatipReceptionStatus {
+  enum { eMaxFields = 10 };
+  char system;          // 'S', 'T', 'C' or 0 if unknown
+  int srcId;
+  int frontendId;
+  int level;
+  bool lock;
+  int quality;
+  const char *transponder;
+  size_t transponderLength;
+  const char *field[eMaxFields];
+  size_t fieldLength[eMaxFields];
+  int fieldCount;
+};
+
+bool SatipParseReceptionStatus(const char *bufferP, size_t lengthP, tSatipReceptionStatus *statusP);
+bool SatipToVdrTransponder(tSatipReceptionStatus *statusP, const cChannel *channelP, int *sourceP, int *frequencyP, int *symbolRateP, char *parametersP, size_t sizeP);
@@ -76,6 +76,7 @@ void cSatipPoller::Action(void)
   uint64_t maxElapsed = 0;
   // Increase priority
   SetPriority(-1);
+  SetThreadScheduling(SATIP_THREAD_POLLER);
   // Do the thread loop
   while (Running()) {
         int nfds = epoll_wait(fdM, events, eMaxFileDescriptors, -1);
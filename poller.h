@@ -16,7 +16,7 @@
 class cSatipPoller : public cThread {
 private:
   enum {
-    eMaxFileDescriptors = SATIP_MAX_DEVICES * 2, // Data + Application
+    eMaxFileDescriptors = SATIP_MAX_DEVICES * 3, // Data + Application + RTSP
   };
   static cSatipPoller *instanceS;
   cMutex mutexM;
@@ -7,14 +7,100 @@
 
 #define __STDC_FORMAT_MACROS // Required for format specifiers
 #include <inttypes.h>
+#include <sys/socket.h>
 
 #include "config.h"
 #include "common.h"
 #include "log.h"
+#include "poller.h"
 #include "rtsp.h"
 
+#define SATIP_RTSP_PERFORM(X) \
+  if ((res = (X)) != CURLE_OK) { \
+     esyslog("curl_easy_perform() [%s,%d] failed: %s (%d)",  __FILE__, __LINE__, curl_easy_strerror(res), res); \
+     }
+
+// --- cSatipRtspPool ---------------------------------------------------------
+
+cSatipRtspPool *cSatipRtspPool::instanceS = NULL;
+
+cSatipRtspPool *cSatipRtspPool::GetInstance(void)
+{
+  if (!instanceS)
+     instanceS = new cSatipRtspPool();
+  return instanceS;
+}
+
+void cSatipRtspPool::Destroy(void)
+{
+  DELETE_POINTER(instanceS);
+}
+
+cSatipRtspPool::cSatipRtspPool()
+: shareM(NULL),
+  dnsShareM(NULL)
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  shareM = Create(true);
+  dnsShareM = Create(false);
+}
+
+cSatipRtspPool::~cSatipRtspPool()
+{
+  dbg_funcname("%s", __PRETTY_FUNCTION__);
+  if (shareM)
+     curl_share_cleanup(shareM);
+  shareM = NULL;
+  if (dnsShareM)
+     curl_share_cleanup(dnsShareM);
+  dnsShareM = NULL;
+}
+
+CURLSH *cSatipRtspPool::Create(bool connectionsP)
+{
+  CURLSH *share = NULL;
+#if defined(LIBCURL_VERSION_NUM) && LIBCURL_VERSION_NUM >= 0x073900
+  share = curl_share_init();
+  if (share) {
+     CURLSHcode res = CURLSHE_OK;
+     if (((res = curl_share_setopt(share, CURLSHOPT_LOCKFUNC, cSatipRtspPool::LockCallback)) != CURLSHE_OK) ||
+         ((res = curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, cSatipRtspPool::UnlockCallback)) != CURLSHE_OK) ||
+         ((res = curl_share_setopt(share, CURLSHOPT_USERDATA, this)) != CURLSHE_OK) ||
+         ((res = curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS)) != CURLSHE_OK) ||
+         (connectionsP && ((res = curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT)) != CURLSHE_OK))) {
+        error("Unable to share RTSP connections: %s (%d)", curl_share_strerror(res), res);
+        curl_share_cleanup(share);
+        share = NULL;
+        }
+     }
+#endif
+  return share;
+}
+
+void cSatipRtspPool::LockCallback(CURL *handleP, curl_lock_data dataP, curl_lock_access accessP, void *userPtrP)
+{
+  cSatipRtspPool *obj = reinterpret_cast<cSatipRtspPool *>(userPtrP);
+  if (obj && (dataP >= 0) && (dataP < CURL_LOCK_DATA_LAST))
+     obj->mutexM[dataP].Lock();
+}
+
+void cSatipRtspPool::UnlockCallback(CURL *handleP, curl_lock_data dataP, void *userPtrP)
+{
+  cSatipRtspPool *obj = reinterpret_cast<cSatipRtspPool *>(userPtrP);
+  if (obj && (dataP >= 0) && (dataP < CURL_LOCK_DATA_LAST))
+     obj->mutexM[dataP].Unlock();
+}
+
+// --- cSatipRtsp -------------------------------------------------------------
+
+#ifndef USE_NATIVE_RTSP
+
 cSatipRtsp::cSatipRtsp(cSatipTunerIf &tunerP)
 : tunerM(tunerP),
+  readMutexM(),
+  fdM(-1),
+  registeredM(false),
+  busyM(false),
   headerBufferM(),
   dataBufferM(),
   handleM(NULL),
@@ -23,6 +109,7 @@ cSatipRtsp::cSatipRtsp(cSatipTunerIf &tunerP)
   errorOutOfRangeM(""),
   errorCheckSyntaxM(""),
   modeM(cSatipConfig::eTransportModeUnicast),
+  transportErrorM(false),
   interleavedRtpIdM(0),
   interleavedRtcpIdM(1)
 {
@@ -84,6 +171,171 @@ size_t cSatipRtsp::InterleaveCallback(char *ptrP, size_t sizeP, size_t nmembP, v
   return len;
 }
 
+int cSatipRtsp::GetFd(void)
+{
+  return fdM;
+}
+
+void cSatipRtsp::Process(void)
+{
+  dbg_funcname_ext("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  cMutexLock MutexLock(&readMutexM);
+  // The connection belongs to curl during a request
+  if (!busyM)
+     Read();
+}
+
+void cSatipRtsp::Process(unsigned char *dataP, int lengthP)
+{
+}
+
+cString cSatipRtsp::ToString(void) const
+{
+  return cString::sprintf("RTSP [device %d]", tunerM.GetId());
+}
+
+bool cSatipRtsp::IsFrameStart(const unsigned char *dataP, size_t lengthP) const
+{
+  // Interleaved frame: '$' <channel> <length:16> <data>
+  return (dataP[0] == '$') && ((lengthP < 2) || (dataP[1] == interleavedRtpIdM) || (dataP[1] == interleavedRtcpIdM));
+}
+
+bool cSatipRtsp::IsMessageStart(const unsigned char *dataP, size_t lengthP) const
+{
+  // A response or a request of the server like ANNOUNCE
+  if ((lengthP >= 5) && !memcmp(dataP, "RTSP/", 5))
+     return true;
+  size_t i = 0;
+  while ((i < lengthP) && (i < eMaxMethodLength) && (((dataP[i] >= 'A') && (dataP[i] <= 'Z')) || (dataP[i] == '_')))
+        ++i;
+  return (i > 0) && (i + 8 <= lengthP) && !memcmp(dataP + i, " rtsp://", 8);
+}
+
+void cSatipRtsp::Read(void)
+{
+  // Must be called with the read mutex held; drains the socket as the poller is edge-triggered
+  while (fdM >= 0) {
+        ssize_t len = recv(fdM, receiveM, sizeof(receiveM), MSG_PEEK | MSG_DONTWAIT);
+        if (len < 0) {
+           if (errno == EINTR)
+              continue;
+           if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+              transportErrorM = true;
+           return;
+           }
+        if (len == 0) {
+           // Connection closed by the server
+           transportErrorM = true;
+           return;
+           }
+        // Only whole frames are consumed, so curl always finds the connection at a frame boundary
+        size_t pos = 0;
+        size_t skipped = 0;
+        while (pos < (size_t)len) {
+              unsigned char *p = receiveM + pos;
+              size_t available = (size_t)len - pos;
+              if (IsFrameStart(p, available)) {
+                 if (available < 4)
+                    break;
+                 size_t count = (p[2] << 8) | p[3];
+                 if (available < 4 + count)
+                    break;
+                 if (count > 0) {
+                    if (p[1] == interleavedRtpIdM)
+                       tunerM.ProcessRtpData(p + 4, (int)count);
+                    else
+                       tunerM.ProcessRtcpData(p + 4, (int)count);
+                    }
+                 pos += 4 + count;
+                 continue;
+                 }
+              if (IsMessageStart(p, available)) {
+                 // Sent by the server on its own or left behind by curl, so nobody waits for it
+                 const char *eoh = (const char *)memmem(p, available, "\r\n\r\n", 4);
+                 size_t length = 0;
+                 if (eoh) {
+                    size_t headerLength = eoh + 4 - (const char *)p;
+                    cSatipHeader header((const char *)p, headerLength);
+                    length = headerLength + (header.Find("Content-Length") ? (size_t)std::max(header.IntValue(0), 0) : 0);
+                    }
+                 if (eoh && (available >= length)) {
+                    info("Discarded an RTSP message outside of a request: %.*s [device %d]", (int)strcspn((const char *)p, "\r"), p, tunerM.GetId());
+                    pos += length;
+                    continue;
+                    }
+                 // Wait for the rest unless it can never fit in the buffer
+                 if (pos || ((size_t)len < sizeof(receiveM)))
+                    break;
+                 }
+              // Resynchronize to the next frame of our channels or the next message
+              size_t start = pos++;
+              while ((pos < (size_t)len) && !IsFrameStart(receiveM + pos, (size_t)len - pos) && (receiveM[pos] != 'R'))
+                    ++pos;
+              skipped += pos - start;
+              }
+        if (skipped)
+           info("Skipped %zu bytes to resynchronize the interleaved data [device %d]", skipped, tunerM.GetId());
+        // A partial frame or message waits for more data
+        if (!pos)
+           return;
+        // The peeked frames are dropped from the socket without copying them again
+        if (recv(fdM, receiveM, pos, MSG_TRUNC | MSG_DONTWAIT) != (ssize_t)pos) {
+           error("Cannot consume interleaved data [device %d]", tunerM.GetId());
+           transportErrorM = true;
+           return;
+           }
+        }
+}
+
+void cSatipRtsp::UpdateSocket(void)
+{
+  // Must be called with the read mutex held; curl might have opened a new connection
+  int fd = -1;
+  bool reconnected = false;
+#if defined(LIBCURL_VERSION_NUM) && LIBCURL_VERSION_NUM >= 0x072D00
+  if (handleM && (modeM == cSatipConfig::eTransportModeRtpOverTcp) && !transportErrorM) {
+     curl_socket_t sock = CURL_SOCKET_BAD;
+     long connects = 0;
+     if ((curl_easy_getinfo(handleM, CURLINFO_ACTIVESOCKET, &sock) == CURLE_OK) && (sock != CURL_SOCKET_BAD))
+        fd = (int)sock;
+     // A new connection may well get the descriptor number of the closed one
+     if ((fd >= 0) && (curl_easy_getinfo(handleM, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK))
+        reconnected = (connects > 0);
+     }
+#endif
+  if ((fd == fdM) && !reconnected)
+     return;
+  if (registeredM) {
+     // Closing the old socket has removed it from the poller already if its number got reused
+     if (fd != fdM)
+        cSatipPoller::GetInstance()->Unregister(*this);
+     registeredM = false;
+     }
+  fdM = fd;
+  if (fdM >= 0) {
+     registeredM = cSatipPoller::GetInstance()->Register(*this);
+     if (!registeredM)
+        fdM = -1;
+     }
+  dbg_funcname("%s fd=%d [device %d]", __PRETTY_FUNCTION__, fdM, tunerM.GetId());
+}
+
+CURLcode cSatipRtsp::Perform(void)
+{
+  readMutexM.Lock();
+  busyM = true;
+  readMutexM.Unlock();
+  CURLcode res = curl_easy_perform(handleM);
+  cMutexLock MutexLock(&readMutexM);
+  busyM = false;
+  transportErrorM = (res != CURLE_OK);
+  UpdateSocket();
+  // Anything left behind by curl doesn't trigger the edge-triggered poller again
+  Read();
+
+  return res;
+}
+
 int cSatipRtsp::DebugCallback(CURL *handleP, curl_infotype typeP, char *dataP, size_t sizeP, void *userPtrP)
 {
   cSatipRtsp *obj = reinterpret_cast<cSatipRtsp *>(userPtrP);
@@ -166,12 +418,32 @@ void cSatipRtsp::Create(void)
 
      // Set user-agent
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_USERAGENT, *cString::sprintf("vdr-%s/%s (device %d)", PLUGIN_NAME_I18N, VERSION, tunerM.GetId()));
+
+     // Use the shared connection pool unless the connection might carry an interleaved stream
+     Share(!SatipConfig.IsTransportModeRtpOverTcp() && (modeM != cSatipConfig::eTransportModeRtpOverTcp));
      }
+  transportErrorM = false;
+}
+
+void cSatipRtsp::Share(bool connectionsP)
+{
+  CURLcode res = CURLE_OK;
+  CURLSH *share = cSatipRtspPool::GetInstance()->Share(connectionsP);
+  SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_SHARE, share);
 }
 
 void cSatipRtsp::Destroy(void)
 {
   dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  {
+  // The poller must let go of the socket before curl closes it
+  cMutexLock MutexLock(&readMutexM);
+  if (registeredM) {
+     cSatipPoller::GetInstance()->Unregister(*this);
+     registeredM = false;
+     }
+  fdM = -1;
+  }
   if (handleM) {
      // Cleanup curl stuff
      if (headerListM) {
@@ -185,9 +457,23 @@ void cSatipRtsp::Destroy(void)
 
 void cSatipRtsp::Reset(void)
 {
-  dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
-  Destroy();
+  dbg_funcname("%s transportError=%d [device %d]", __PRETTY_FUNCTION__, transportErrorM, tunerM.GetId());
+  // Interleaved data might still be pending on the socket, so RTP-over-TCP always starts from scratch
+  if (!handleM || transportErrorM || (modeM == cSatipConfig::eTransportModeRtpOverTcp)) {
+     Destroy();
+     Create();
+     return;
+     }
+  // Forget the session state, but keep the control connection open
+  CURLcode res = CURLE_OK;
+  if (headerListM) {
+     curl_slist_free_all(headerListM);
+     headerListM = NULL;
+     }
+  curl_easy_reset(handleM);
   Create();
+  SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_CLIENT_CSEQ, 1L);
+  SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_SESSION_ID, NULL);
 }
 
 bool cSatipRtsp::SetInterface(const char *bindAddrP)
@@ -212,6 +498,9 @@ bool cSatipRtsp::Receive(const char *uriP)
   bool result = false;
 
   if (handleM && !isempty(uriP) && modeM == cSatipConfig::eTransportModeRtpOverTcp) {
+     // Interleaved data is normally read by the poller
+     if (registeredM)
+        return !transportErrorM;
      long rc = 0;
      cTimeMs processing(0);
      CURLcode res = CURLE_OK;
@@ -219,7 +508,8 @@ bool cSatipRtsp::Receive(const char *uriP)
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_URL, uriP);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_STREAM_URI, uriP);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_REQUEST, (long)CURL_RTSPREQ_OPTIONS); // FIXME: this really should be CURL_RTSPREQ_RECEIVE, but getting timeout errors
-     SATIP_CURL_EASY_PERFORM(handleM);
+     SATIP_RTSP_PERFORM(Perform());
+     transportErrorM = (res != CURLE_OK);
 
      result = ValidateLatestResponse(&rc);
      dbg_rtsp("%s (%s) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rc, processing.Elapsed(), tunerM.GetId());
@@ -241,7 +531,8 @@ bool cSatipRtsp::Options(const char *uriP)
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_URL, uriP);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_STREAM_URI, uriP);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_REQUEST, (long)CURL_RTSPREQ_OPTIONS);
-     SATIP_CURL_EASY_PERFORM(handleM);
+     SATIP_RTSP_PERFORM(Perform());
+     transportErrorM = (res != CURLE_OK);
 
      result = ValidateLatestResponse(&rc);
      dbg_rtsp("%s (%s) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rc, processing.Elapsed(), tunerM.GetId());
@@ -276,7 +567,8 @@ bool cSatipRtsp::Setup(const char *uriP, int rtpPortP, int rtcpPortP, bool useTc
             break;
        }
 
-     // Setup media stream
+     // Setup media stream; the URL is set here as well in case OPTIONS was skipped
+     SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_URL, uriP);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_STREAM_URI, uriP);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_TRANSPORT, *transport);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_REQUEST, (long)CURL_RTSPREQ_SETUP);
@@ -287,8 +579,16 @@ bool cSatipRtsp::Setup(const char *uriP, int rtpPortP, int rtcpPortP, bool useTc
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, this);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEFUNCTION, NULL);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEDATA, NULL);
+     // The interleaved stream needs a connection of its own that never goes back to the pool
+     if (useTcpP) {
+        Share(false);
+        SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_FRESH_CONNECT, 1L);
+        }
 
-     SATIP_CURL_EASY_PERFORM(handleM);
+     SATIP_RTSP_PERFORM(Perform());
+     transportErrorM = (res != CURLE_OK);
+     if (useTcpP)
+        SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_FRESH_CONNECT, 0L);
      // Session id is now known - disable header parsing
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_HEADERFUNCTION, NULL);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEHEADER, NULL);
@@ -337,11 +637,12 @@ bool cSatipRtsp::Describe(const char *uriP)
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_REQUEST, (long)CURL_RTSPREQ_DESCRIBE);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEFUNCTION, cSatipRtsp::DataCallback);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, this);
-     SATIP_CURL_EASY_PERFORM(handleM);
+     SATIP_RTSP_PERFORM(Perform());
+     transportErrorM = (res != CURLE_OK);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEFUNCTION, NULL);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, NULL);
      if (dataBufferM.Size() > 0) {
-        tunerM.ProcessApplicationData((u_char *)dataBufferM.Data(), dataBufferM.Size());
+        tunerM.ProcessDescribeData((u_char *)dataBufferM.Data(), dataBufferM.Size());
         dataBufferM.Reset();
         }
 
@@ -366,7 +667,8 @@ bool cSatipRtsp::Play(const char *uriP)
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_RTSP_REQUEST, (long)CURL_RTSPREQ_PLAY);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEFUNCTION, cSatipRtsp::DataCallback);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, this);
-     SATIP_CURL_EASY_PERFORM(handleM);
+     SATIP_RTSP_PERFORM(Perform());
+     transportErrorM = (res != CURLE_OK);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEFUNCTION, NULL);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, NULL);
      if (dataBufferM.Size() > 0) {
@@ -397,7 +699,8 @@ bool cSatipRtsp::Teardown(const char *uriP)
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, this);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEFUNCTION, NULL);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEDATA, NULL);
-     SATIP_CURL_EASY_PERFORM(handleM);
+     SATIP_RTSP_PERFORM(Perform());
+     transportErrorM = (res != CURLE_OK);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEFUNCTION, NULL);
      SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_WRITEDATA, NULL);
      if (dataBufferM.Size() > 0) {
@@ -418,93 +721,78 @@ bool cSatipRtsp::Teardown(const char *uriP)
 void cSatipRtsp::ParseHeader(void)
 {
   dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
-  char *s, *p = headerBufferM.Data();
-  char *r = strtok_r(p, "\r\n", &s);
-
-  while (r) {
-        dbg_funcname_ext("%s (%zu): %s", __PRETTY_FUNCTION__, headerBufferM.Size(), r);
-        r = skipspace(r);
-        if (strstr(r, "com.ses.streamID")) {
-           int streamid = -1;
-           if (sscanf(r, "com.ses.streamID:%11d", &streamid) == 1)
+  cSatipHeader header(headerBufferM.Data(), headerBufferM.Size());
+
+  while (header.Next()) {
+        dbg_funcname_ext("%s (%zu): %.*s", __PRETTY_FUNCTION__, headerBufferM.Size(), (int)header.LineLength(), header.Line());
+        if (header.Is("com.ses.streamID")) {
+           int streamid = header.IntValue(-1);
+           if (streamid >= 0)
               tunerM.SetStreamId(streamid);
            }
-        else if (strstr(r, "Session:")) {
-           int timeout = -1;
-           char *session = NULL;
-           if (sscanf(r, "Session:%m[^;];timeout=%11d", &session, &timeout) == 2)
-              tunerM.SetSessionTimeout(skipspace(session), timeout * 1000);
-           else if (sscanf(r, "Session:%m[^;]", &session) == 1)
-              tunerM.SetSessionTimeout(skipspace(session), -1);
-           FREE_POINTER(session);
+        else if (header.Is("Session")) {
+           cSatipSessionHeader session;
+           if (session.Parse(header.Value(), header.ValueLength()))
+              tunerM.SetSessionTimeout(session.Id(), (session.Timeout() >= 0) ? session.Timeout() * 1000 : -1);
            }
-        else if (strstr(r, "Transport:")) {
+        else if (header.Is("Transport")) {
            CURLcode res = CURLE_OK;
-           int rtp = -1, rtcp = -1, ttl = -1;
-           char *tmp = NULL, *destination = NULL, *source = NULL;
+           cSatipTransportHeader transport;
            interleavedRtpIdM = 0;
            interleavedRtcpIdM = 1;
            SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEFUNCTION, NULL);
            SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEDATA, NULL);
-           if (sscanf(r, "Transport:%m[^;];unicast;client_port=%11d-%11d", &tmp, &rtp, &rtcp) == 3) {
-              modeM = cSatipConfig::eTransportModeUnicast;
-              tunerM.SetupTransport(rtp, rtcp, NULL, NULL);
-              }
-           else if (sscanf(r, "Transport:%m[^;];multicast;destination=%m[^;];port=%11d-%11d;ttl=%11d;source=%m[^;]", &tmp, &destination, &rtp, &rtcp, &ttl, &source) == 6 ||
-                    sscanf(r, "Transport:%m[^;];multicast;destination=%m[^;];port=%11d-%11d;ttl=%11d", &tmp, &destination, &rtp, &rtcp, &ttl) == 5) {
-              modeM = cSatipConfig::eTransportModeMulticast;
-              tunerM.SetupTransport(rtp, rtcp, destination, source);
-              }
-           else if (sscanf(r, "Transport:%m[^;];interleaved=%11d-%11d", &tmp, &rtp, &rtcp) == 3) {
-              interleavedRtpIdM = rtp;
-              interleavedRtcpIdM = rtcp;
-              SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEFUNCTION, cSatipRtsp::InterleaveCallback);
-              SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEDATA, this);
-              modeM = cSatipConfig::eTransportModeRtpOverTcp;
-              tunerM.SetupTransport(-1, -1, NULL, NULL);
-              }
-           FREE_POINTER(tmp);
-           FREE_POINTER(destination);
-           FREE_POINTER(source);
+           transport.Parse(header.Value(), header.ValueLength());
+           switch (transport.Mode()) {
+             case cSatipTransportHeader::eModeUnicast:
+                  modeM = cSatipConfig::eTransportModeUnicast;
+                  tunerM.SetupTransport(transport.Rtp(), transport.Rtcp(), NULL, NULL);
+                  break;
+             case cSatipTransportHeader::eModeMulticast:
+                  modeM = cSatipConfig::eTransportModeMulticast;
+                  tunerM.SetupTransport(transport.Rtp(), transport.Rtcp(), transport.Destination(), transport.Source());
+                  break;
+             case cSatipTransportHeader::eModeInterleaved:
+                  interleavedRtpIdM = transport.Rtp();
+                  interleavedRtcpIdM = transport.Rtcp();
+                  SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEFUNCTION, cSatipRtsp::InterleaveCallback);
+                  SATIP_CURL_EASY_SETOPT(handleM, CURLOPT_INTERLEAVEDATA, this);
+                  modeM = cSatipConfig::eTransportModeRtpOverTcp;
+                  tunerM.SetupTransport(-1, -1, NULL, NULL);
+                  break;
+             default:
+                  break;
+             }
            }
-        r = strtok_r(NULL, "\r\n", &s);
         }
 }
 
 void cSatipRtsp::ParseData(void)
 {
   dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
-  char *s, *p = dataBufferM.Data();
-  char *r = strtok_r(p, "\r\n", &s);
-
-  while (r) {
-        dbg_funcname_ext("%s (%zu): %s", __PRETTY_FUNCTION__, dataBufferM.Size(), r);
-        r = skipspace(r);
-        if (strstr(r, "No-More:")) {
-           char *tmp = NULL;
-           if (sscanf(r, "No-More:%m[^;]", &tmp) == 1) {
-              errorNoMoreM = skipspace(tmp);
+  cSatipHeader data(dataBufferM.Data(), dataBufferM.Size());
+  char tmp[128];
+
+  while (data.Next()) {
+        dbg_funcname_ext("%s (%zu): %.*s", __PRETTY_FUNCTION__, dataBufferM.Size(), (int)data.LineLength(), data.Line());
+        if (data.Is("No-More")) {
+           if (data.CopyValue(tmp, sizeof(tmp), ';')) {
+              errorNoMoreM = tmp;
               dbg_parsing("%s No-More: %s [device %d]", __PRETTY_FUNCTION__, *errorNoMoreM, tunerM.GetId());
               }
-           FREE_POINTER(tmp);
            }
-        else if (strstr(r, "Out-of-Range:")) {
-           char *tmp = NULL;
-           if (sscanf(r, "Out-of-Range:%m[^;]", &tmp) == 1) {
-              errorOutOfRangeM = skipspace(tmp);
+        else if (data.Is("Out-of-Range")) {
+           if (data.CopyValue(tmp, sizeof(tmp), ';')) {
+              errorOutOfRangeM = tmp;
               dbg_parsing("%s Out-of-Range: %s [device %d]", __PRETTY_FUNCTION__, *errorOutOfRangeM, tunerM.GetId());
               }
-           FREE_POINTER(tmp);
            }
-        else if (strstr(r, "Check-Syntax:")) {
-           char *tmp = NULL;
-           if (sscanf(r, "Check-Syntax:%m[^;]", &tmp) == 1) {
-              errorCheckSyntaxM = skipspace(tmp);
+        else if (data.Is("Check-Syntax")) {
+           if (data.CopyValue(tmp, sizeof(tmp), ';')) {
+              errorCheckSyntaxM = tmp;
               dbg_parsing("%s Check-Syntax: %s [device %d]", __PRETTY_FUNCTION__, *errorCheckSyntaxM, tunerM.GetId());
               }
-           FREE_POINTER(tmp);
            }
-        r = strtok_r(NULL, "\r\n", &s);
         }
 }
 
@@ -566,3 +854,5 @@ bool cSatipRtsp::ValidateLatestResponse(long *rcP)
 
   return result;
 }
+
+#endif // USE_NATIVE_RTSP
@@ -15,10 +15,121 @@
 #error "libcurl is missing required RTSP support"
 #endif
 
+#include <vdr/thread.h>
+
 #include "common.h"
+#include "pollerif.h"
 #include "tunerif.h"
 
-class cSatipRtsp {
+// --- cSatipRtspPool ---------------------------------------------------------
+
+// Shared connection cache: idle RTSP control connections stay open and any
+// tuner talking to the same server can pick them up again. Connections
+// carrying an interleaved stream are never shared, only the DNS cache.
+class cSatipRtspPool {
+private:
+  static cSatipRtspPool *instanceS;
+  CURLSH *shareM;
+  CURLSH *dnsShareM;
+  CURLSH *Create(bool connectionsP);
+  cMutex mutexM[CURL_LOCK_DATA_LAST];
+  static void LockCallback(CURL *handleP, curl_lock_data dataP, curl_lock_access accessP, void *userPtrP);
+  static void UnlockCallback(CURL *handleP, curl_lock_data dataP, void *userPtrP);
+  cSatipRtspPool();
+
+public:
+  static cSatipRtspPool *GetInstance(void);
+  static void Destroy(void);
+  virtual ~cSatipRtspPool();
+  CURLSH *Share(bool connectionsP) { return connectionsP ? shareM : dnsShareM; }
+};
+
+// --- cSatipRtsp -------------------------------------------------------------
+
+#ifdef USE_NATIVE_RTSP
+
+// In-tree RTSP/1.0 client for the SAT>IP subset working on fixed buffers. In
+// RTP-over-TCP mode the control socket is served by cSatipPoller.
+class cSatipRtsp : public cSatipPollerIf {
+private:
+  enum {
+    eConnectTimeoutMs      = 1500,  // in milliseconds
+    eRequestBufferSize     = SATIP_MAX_PID_LIST_LENGTH + KILOBYTE(2), // the whole pid list and the headers
+    eResponseBufferSize    = KILOBYTE(4),
+    eReceiveBufferSize     = KILOBYTE(68), // the largest interleaved frame and a response
+    eAddressLength         = 64,
+    eSessionLength         = 64,
+    eErrorLength           = 128
+  };
+
+  cSatipTunerIf &tunerM;
+  cMutex mutexM;
+  cCondVar responseCondM;
+  int fdM;
+  bool registeredM;
+  char hostM[eAddressLength];
+  int portM;
+  char bindAddrM[eAddressLength];
+  char sessionM[eSessionLength];
+  unsigned int cseqM;
+  char errorNoMoreM[eErrorLength];
+  char errorOutOfRangeM[eErrorLength];
+  char errorCheckSyntaxM[eErrorLength];
+  int modeM;
+  bool transportErrorM;
+  unsigned int interleavedRtpIdM;
+  unsigned int interleavedRtcpIdM;
+  char requestM[eRequestBufferSize];
+  unsigned char receiveM[eReceiveBufferSize];
+  size_t receiveLengthM;
+  char responseM[eResponseBufferSize + 1];
+  size_t responseLengthM;
+  size_t responseHeaderLengthM;
+  bool responseReadyM;
+  long statusCodeM;
+
+  bool Connect(const char *uriP);
+  void Disconnect(void);
+  bool Read(void);
+  void Consume(void);
+  bool Request(const char *methodP, const char *uriP, const char *headersP);
+  void ParseHeader(void);
+  void ParseData(void);
+  bool ValidateLatestResponse(const char *uriP, long *rcP);
+
+  // to prevent copy constructor and assignment
+  cSatipRtsp(const cSatipRtsp&);
+  cSatipRtsp& operator=(const cSatipRtsp&);
+
+public:
+  explicit cSatipRtsp(cSatipTunerIf &tunerP);
+  virtual ~cSatipRtsp();
+
+  cString GetActiveMode(void);
+  cString RtspUnescapeString(const char *strP);
+  void Reset(void);
+  bool SetInterface(const char *bindAddrP);
+  bool Receive(const char *uriP);
+  bool Options(const char *uriP);
+  bool Setup(const char *uriP, int rtpPortP, int rtcpPortP, bool useTcpP);
+  bool SetSession(const char *sessionP);
+  bool Describe(const char *uriP);
+  bool Play(const char *uriP);
+  bool Teardown(const char *uriP);
+
+  // for internal poller interface
+public:
+  virtual int GetFd(void);
+  virtual void Process(void);
+  virtual void Process(unsigned char *dataP, int lengthP);
+  virtual cString ToString(void) const;
+};
+
+#else
+
+// In RTP-over-TCP mode the interleaved frames are read by cSatipPoller
+// between the requests, which curl still performs on the same socket.
+class cSatipRtsp : public cSatipPollerIf {
 private:
   static size_t HeaderCallback(char *ptrP, size_t sizeP, size_t nmembP, void *dataP);
   static size_t DataCallback(char *ptrP, size_t sizeP, size_t nmembP, void *dataP);
@@ -27,9 +138,16 @@ private:
 
   enum {
     eConnectTimeoutMs      = 1500,  // in milliseconds
+    eReceiveBufferSize     = KILOBYTE(68), // the largest interleaved frame
+    eMaxMethodLength       = 16,
   };
 
   cSatipTunerIf &tunerM;
+  cMutex readMutexM;
+  int fdM;
+  bool registeredM;
+  bool busyM;
+  unsigned char receiveM[eReceiveBufferSize];
   cSatipMemoryBuffer headerBufferM;
   cSatipMemoryBuffer dataBufferM;
   CURL *handleM;
@@ -38,11 +156,18 @@ private:
   cString errorOutOfRangeM;
   cString errorCheckSyntaxM;
   int modeM;
+  bool transportErrorM;
   unsigned int interleavedRtpIdM;
   unsigned int interleavedRtcpIdM;
 
   void Create(void);
+  void Share(bool connectionsP);
   void Destroy(void);
+  CURLcode Perform(void);
+  void UpdateSocket(void);
+  bool IsFrameStart(const unsigned char *dataP, size_t lengthP) const;
+  bool IsMessageStart(const unsigned char *dataP, size_t lengthP) const;
+  void Read(void);
   void ParseHeader(void);
   void ParseData(void);
   bool ValidateLatestResponse(long *rcP);
@@ -66,6 +191,15 @@ public:
   bool Describe(const char *uriP);
   bool Play(const char *uriP);
   bool Teardown(const char *uriP);
+
+  // for internal poller interface
+public:
+  virtual int GetFd(void);
+  virtual void Process(void);
+  virtual void Process(unsigned char *dataP, int lengthP);
+  virtual cString ToString(void) const;
 };
 
+#endif // USE_NATIVE_RTSP
+
 #endif // __SATIP_RTSP_H
@@ -0,0 +1,658 @@
+/*
+ * rtspnative.c: SAT>IP plugin for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#define __STDC_FORMAT_MACROS // Required for format specifiers
+#include <inttypes.h>
+#include <algorithm>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "common.h"
+#include "log.h"
+#include "poller.h"
+#include "rtsp.h"
+
+#ifdef USE_NATIVE_RTSP
+
+cSatipRtsp::cSatipRtsp(cSatipTunerIf &tunerP)
+: tunerM(tunerP),
+  mutexM(),
+  responseCondM(),
+  fdM(-1),
+  registeredM(false),
+  portM(SATIP_DEFAULT_RTSP_PORT),
+  cseqM(1),
+  modeM(cSatipConfig::eTransportModeUnicast),
+  transportErrorM(false),
+  interleavedRtpIdM(0),
+  interleavedRtcpIdM(1),
+  receiveLengthM(0),
+  responseLengthM(0),
+  responseHeaderLengthM(0),
+  responseReadyM(false),
+  statusCodeM(0)
+{
+  dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  hostM[0] = 0;
+  bindAddrM[0] = 0;
+  sessionM[0] = 0;
+  errorNoMoreM[0] = 0;
+  errorOutOfRangeM[0] = 0;
+  errorCheckSyntaxM[0] = 0;
+  responseM[0] = 0;
+}
+
+cSatipRtsp::~cSatipRtsp()
+{
+  dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  cMutexLock MutexLock(&mutexM);
+  Disconnect();
+}
+
+int cSatipRtsp::GetFd(void)
+{
+  return fdM;
+}
+
+void cSatipRtsp::Process(void)
+{
+  dbg_funcname_ext("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  cMutexLock MutexLock(&mutexM);
+  Read();
+}
+
+void cSatipRtsp::Process(unsigned char *dataP, int lengthP)
+{
+}
+
+cString cSatipRtsp::ToString(void) const
+{
+  return cString::sprintf("RTSP [device %d]", tunerM.GetId());
+}
+
+cString cSatipRtsp::GetActiveMode(void)
+{
+  switch (modeM) {
+    case cSatipConfig::eTransportModeUnicast:
+         return "Unicast";
+    case cSatipConfig::eTransportModeMulticast:
+         return "Multicast";
+    case cSatipConfig::eTransportModeRtpOverTcp:
+         return "RTP-over-TCP";
+    default:
+         break;
+    }
+  return "";
+}
+
+cString cSatipRtsp::RtspUnescapeString(const char *strP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, strP, tunerM.GetId());
+  if (isempty(strP))
+     return cString(strP);
+
+  // Percent-decoding never grows the string, so it's done in place
+  char *s = strdup(strP);
+  char *d = s;
+  for (const char *p = strP; *p; ++p) {
+      unsigned int c;
+      if ((*p == '%') && isxdigit(p[1]) && isxdigit(p[2]) && (sscanf(p + 1, "%2x", &c) == 1)) {
+         *d++ = (char)c;
+         p += 2;
+         }
+      else
+         *d++ = *p;
+      }
+  *d = 0;
+
+  return cString(s, true);
+}
+
+bool cSatipRtsp::Connect(const char *uriP)
+{
+  // rtsp://<host>[:<port>]/...
+  const char *host = startswith(uriP, "rtsp://") ? uriP + 7 : uriP;
+  const char *hostEnd = host + strcspn(host, ":/");
+  char address[eAddressLength];
+  int port = SATIP_DEFAULT_RTSP_PORT;
+
+  cSatipHeader::Copy(address, sizeof(address), host, hostEnd - host);
+  if (*hostEnd == ':')
+     port = atoi(hostEnd + 1);
+
+  if ((fdM >= 0) && !transportErrorM && (port == portM) && !strcmp(address, hostM))
+     return true;
+
+  Disconnect();
+  dbg_funcname("%s (%s:%d) [device %d]", __PRETTY_FUNCTION__, address, port, tunerM.GetId());
+
+  struct sockaddr_in sockAddr;
+  memset(&sockAddr, 0, sizeof(sockAddr));
+  sockAddr.sin_family = AF_INET;
+  sockAddr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, address, &sockAddr.sin_addr) != 1) {
+     struct addrinfo hints, *result = NULL;
+     memset(&hints, 0, sizeof(hints));
+     hints.ai_family = AF_INET;
+     hints.ai_socktype = SOCK_STREAM;
+     if (getaddrinfo(address, NULL, &hints, &result) || !result) {
+        error("Cannot resolve RTSP server %s [device %d]", address, tunerM.GetId());
+        return false;
+        }
+     sockAddr.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+     freeaddrinfo(result);
+     }
+
+  int fd = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  ERROR_IF_RET(fd < 0, "socket()", return false);
+  int yes = 1;
+  ERROR_IF(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) < 0, "setsockopt(TCP_NODELAY)");
+  if (!isempty(bindAddrM)) {
+     struct sockaddr_in bindAddr;
+     memset(&bindAddr, 0, sizeof(bindAddr));
+     bindAddr.sin_family = AF_INET;
+     bindAddr.sin_addr.s_addr = inet_addr(bindAddrM);
+     ERROR_IF_FUNC(bind(fd, (struct sockaddr *)&bindAddr, sizeof(bindAddr)) < 0, "bind()", close(fd), return false);
+     }
+  if (connect(fd, (struct sockaddr *)&sockAddr, sizeof(sockAddr)) < 0) {
+     int err = errno;
+     if (err == EINPROGRESS) {
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        socklen_t len = sizeof(err);
+        if ((poll(&pfd, 1, eConnectTimeoutMs) <= 0) || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+           err = ETIMEDOUT;
+        }
+     if (err) {
+        error("Cannot connect to RTSP server %s:%d: %s [device %d]", address, port, strerror(err), tunerM.GetId());
+        close(fd);
+        return false;
+        }
+     }
+
+  fdM = fd;
+  cSatipHeader::Copy(hostM, sizeof(hostM), address, strlen(address));
+  portM = port;
+  receiveLengthM = 0;
+  transportErrorM = false;
+
+  return true;
+}
+
+void cSatipRtsp::Disconnect(void)
+{
+  if (registeredM) {
+     cSatipPoller::GetInstance()->Unregister(*this);
+     registeredM = false;
+     }
+  if (fdM >= 0) {
+     dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+     close(fdM);
+     fdM = -1;
+     }
+  receiveLengthM = 0;
+  hostM[0] = 0;
+}
+
+bool cSatipRtsp::Read(void)
+{
+  // Must be called with the mutex held; drains the socket as the poller is edge-triggered
+  while (fdM >= 0) {
+        if (receiveLengthM >= sizeof(receiveM)) {
+           error("RTSP receive buffer overflow [device %d]", tunerM.GetId());
+           receiveLengthM = 0;
+           }
+        ssize_t len = recv(fdM, receiveM + receiveLengthM, sizeof(receiveM) - receiveLengthM, MSG_DONTWAIT);
+        if (len > 0) {
+           receiveLengthM += len;
+           Consume();
+           continue;
+           }
+        if (len < 0) {
+           if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+              return true;
+           if (errno == EINTR)
+              continue;
+           }
+        // Connection closed by the server or a socket error
+        transportErrorM = true;
+        responseCondM.Broadcast();
+        break;
+        }
+
+  return false;
+}
+
+void cSatipRtsp::Consume(void)
+{
+  size_t pos = 0;
+
+  while (pos < receiveLengthM) {
+        unsigned char *p = receiveM + pos;
+        size_t available = receiveLengthM - pos;
+        if (*p == '$') {
+           // Interleaved frame: '$' <channel> <length:16> <data>
+           if (available < 4)
+              break;
+           size_t count = (p[2] << 8) | p[3];
+           if (available < 4 + count)
+              break;
+           unsigned int channel = p[1];
+           if (count > 0) {
+              if (channel == interleavedRtpIdM)
+                 tunerM.ProcessRtpData(p + 4, (int)count);
+              else if (channel == interleavedRtcpIdM)
+                 tunerM.ProcessRtcpData(p + 4, (int)count);
+              }
+           pos += 4 + count;
+           }
+        else if ((available >= 5) && !memcmp(p, "RTSP/", 5)) {
+           const char *eoh = (const char *)memmem(p, available, "\r\n\r\n", 4);
+           if (!eoh) {
+              if (available > eResponseBufferSize) {
+                 error("Too long RTSP response header [device %d]", tunerM.GetId());
+                 pos = receiveLengthM;
+                 }
+              break;
+              }
+           size_t headerLength = eoh + 4 - (const char *)p;
+           cSatipHeader header((const char *)p, headerLength);
+           size_t contentLength = header.Find("Content-Length") ? (size_t)std::max(header.IntValue(0), 0) : 0;
+           if (available < headerLength + contentLength)
+              break;
+           if (!responseReadyM) {
+              size_t total = std::min(headerLength + contentLength, (size_t)eResponseBufferSize);
+              memcpy(responseM, p, total);
+              responseM[total] = 0;
+              responseLengthM = total;
+              responseHeaderLengthM = std::min(headerLength, total);
+              statusCodeM = strtol(responseM + strcspn(responseM, " "), NULL, 10);
+              responseReadyM = true;
+              responseCondM.Broadcast();
+              dbg_curlinfo("%s [device %d] RTSP HEAD <<< %.*s", __PRETTY_FUNCTION__, tunerM.GetId(), (int)responseHeaderLengthM, responseM);
+              }
+           pos += headerLength + contentLength;
+           }
+        else if ((available < 5) && !memcmp(p, "RTSP/", available))
+           break;
+        else {
+           // Resynchronize to the next frame or response
+           ++pos;
+           while ((pos < receiveLengthM) && (receiveM[pos] != '$') && (receiveM[pos] != 'R'))
+                 ++pos;
+           }
+        }
+
+  if (pos > 0) {
+     receiveLengthM -= pos;
+     if (receiveLengthM)
+        memmove(receiveM, receiveM + pos, receiveLengthM);
+     }
+}
+
+bool cSatipRtsp::Request(const char *methodP, const char *uriP, const char *headersP)
+{
+  cMutexLock MutexLock(&mutexM);
+  responseReadyM = false;
+  responseLengthM = 0;
+  responseHeaderLengthM = 0;
+  statusCodeM = 0;
+  if (!Connect(uriP)) {
+     transportErrorM = true;
+     return false;
+     }
+
+  int len = snprintf(requestM, sizeof(requestM), "%s %s RTSP/1.0\r\nCSeq: %u\r\nUser-Agent: vdr-%s/%s (device %d)\r\n%s%s%s%s\r\n",
+                     methodP, uriP, cseqM, PLUGIN_NAME_I18N, VERSION, tunerM.GetId(),
+                     isempty(sessionM) ? "" : "Session: ", sessionM, isempty(sessionM) ? "" : "\r\n", headersP ? headersP : "");
+  if ((len < 0) || (len >= (int)sizeof(requestM))) {
+     error("Too long RTSP request: %s [device %d]", uriP, tunerM.GetId());
+     return false;
+     }
+  dbg_curlinfo("%s [device %d] RTSP HEAD >>>\n%.*s", __PRETTY_FUNCTION__, tunerM.GetId(), len, requestM);
+
+  ++cseqM;
+
+  cTimeMs timeout(eConnectTimeoutMs);
+  int sent = 0;
+  while (sent < len) {
+        ssize_t n = send(fdM, requestM + sent, len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+           sent += n;
+        else if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) && !timeout.TimedOut()) {
+           struct pollfd pfd = { fdM, POLLOUT, 0 };
+           poll(&pfd, 1, 100);
+           }
+        else {
+           error("Cannot send RTSP request: %s [device %d]", uriP, tunerM.GetId());
+           transportErrorM = true;
+           return false;
+           }
+        }
+
+  while (!responseReadyM && !transportErrorM && (fdM >= 0)) {
+        int remaining = (int)(eConnectTimeoutMs - timeout.Elapsed());
+        if (remaining <= 0)
+           break;
+        if (registeredM) {
+           // The poller serves the socket and signals the response
+           responseCondM.TimedWait(mutexM, remaining);
+           }
+        else {
+           struct pollfd pfd = { fdM, POLLIN, 0 };
+           mutexM.Unlock();
+           poll(&pfd, 1, remaining);
+           mutexM.Lock();
+           Read();
+           }
+        }
+  if (!responseReadyM) {
+     error("No RTSP response: %s [device %d]", uriP, tunerM.GetId());
+     transportErrorM = true;
+     return false;
+     }
+
+  return true;
+}
+
+void cSatipRtsp::Reset(void)
+{
+  dbg_funcname("%s transportError=%d [device %d]", __PRETTY_FUNCTION__, transportErrorM, tunerM.GetId());
+  cMutexLock MutexLock(&mutexM);
+  // Interleaved data might still be pending on the socket, so RTP-over-TCP always starts from scratch
+  if ((fdM < 0) || transportErrorM || (modeM == cSatipConfig::eTransportModeRtpOverTcp))
+     Disconnect();
+  // Forget the session state, but keep the control connection open
+  cseqM = 1;
+  sessionM[0] = 0;
+  transportErrorM = false;
+}
+
+bool cSatipRtsp::SetInterface(const char *bindAddrP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, bindAddrP, tunerM.GetId());
+  cMutexLock MutexLock(&mutexM);
+  const char *addr = isempty(bindAddrP) ? "" : bindAddrP;
+  if (strcmp(addr, bindAddrM)) {
+     cSatipHeader::Copy(bindAddrM, sizeof(bindAddrM), addr, strlen(addr));
+     // Rebind on the next request
+     Disconnect();
+     }
+
+  return true;
+}
+
+bool cSatipRtsp::Receive(const char *uriP)
+{
+  dbg_funcname_ext("%s (%s) [device %d]", __PRETTY_FUNCTION__, uriP, tunerM.GetId());
+  bool result = false;
+
+  if (!isempty(uriP) && modeM == cSatipConfig::eTransportModeRtpOverTcp) {
+     cMutexLock MutexLock(&mutexM);
+     // Interleaved data is normally read by the poller
+     if (!registeredM)
+        Read();
+     result = (fdM >= 0) && !transportErrorM;
+     }
+
+  return result;
+}
+
+bool cSatipRtsp::Options(const char *uriP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, uriP, tunerM.GetId());
+  bool result = false;
+
+  if (!isempty(uriP)) {
+     long rc = 0;
+     cTimeMs processing(0);
+
+     Request("OPTIONS", uriP, NULL);
+     result = ValidateLatestResponse(uriP, &rc);
+     dbg_rtsp("%s (%s) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rc, processing.Elapsed(), tunerM.GetId());
+     }
+
+  return result;
+}
+
+bool cSatipRtsp::Setup(const char *uriP, int rtpPortP, int rtcpPortP, bool useTcpP)
+{
+  dbg_funcname("%s (%s, %d, %d, %d) [device %d]", __PRETTY_FUNCTION__, uriP, rtpPortP, rtcpPortP, useTcpP, tunerM.GetId());
+  bool result = false;
+
+  if (!isempty(uriP)) {
+     char transport[eAddressLength * 2];
+     long rc = 0;
+     cTimeMs processing(0);
+
+     switch (SatipConfig.GetTransportMode()) {
+       case cSatipConfig::eTransportModeMulticast:
+            // RTP/AVP;multicast;destination=<multicast group address>;port=<RTP port>-<RTCP port>;ttl=<ttl>[;source=<multicast source address>]
+            snprintf(transport, sizeof(transport), "Transport: RTP/AVP;multicast\r\n");
+            break;
+       default:
+            // RTP/AVP;unicast;client_port=<client RTP port>-<client RTCP port>
+            // RTP/AVP/TCP;unicast;client_port=<client RTP port>-<client RTCP port>
+            if (useTcpP)
+               snprintf(transport, sizeof(transport), "Transport: RTP/AVP/TCP;unicast;interleaved=%u-%u\r\n", interleavedRtpIdM, interleavedRtcpIdM);
+            else
+               snprintf(transport, sizeof(transport), "Transport: RTP/AVP;unicast;client_port=%d-%d\r\n", rtpPortP, rtcpPortP);
+            break;
+       }
+
+     if (Request("SETUP", uriP, transport)) {
+        ParseHeader();
+        ParseData();
+        }
+     result = ValidateLatestResponse(uriP, &rc);
+     dbg_rtsp("%s (%s, %d, %d) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rtpPortP, rtcpPortP, rc, processing.Elapsed(), tunerM.GetId());
+     }
+
+  return result;
+}
+
+bool cSatipRtsp::SetSession(const char *sessionP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, sessionP, tunerM.GetId());
+  dbg_funcname("%s: session id quirk enabled [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  const char *session = sessionP ? sessionP : "";
+  cSatipHeader::Copy(sessionM, sizeof(sessionM), session, strlen(session));
+
+  return true;
+}
+
+bool cSatipRtsp::Describe(const char *uriP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, uriP, tunerM.GetId());
+  bool result = false;
+
+  if (!isempty(uriP)) {
+     long rc = 0;
+     cTimeMs processing(0);
+
+     if (Request("DESCRIBE", uriP, "Accept: application/sdp\r\n") && (responseLengthM > responseHeaderLengthM))
+        tunerM.ProcessDescribeData((u_char *)responseM + responseHeaderLengthM, (int)(responseLengthM - responseHeaderLengthM));
+     result = ValidateLatestResponse(uriP, &rc);
+     dbg_rtsp("%s (%s) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rc, processing.Elapsed(), tunerM.GetId());
+     }
+
+  return result;
+}
+
+bool cSatipRtsp::Play(const char *uriP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, uriP, tunerM.GetId());
+  bool result = false;
+
+  if (!isempty(uriP)) {
+     long rc = 0;
+     cTimeMs processing(0);
+
+     if (Request("PLAY", uriP, NULL))
+        ParseData();
+     result = ValidateLatestResponse(uriP, &rc);
+     dbg_rtsp("%s (%s) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rc, processing.Elapsed(), tunerM.GetId());
+     }
+
+  return result;
+}
+
+bool cSatipRtsp::Teardown(const char *uriP)
+{
+  dbg_funcname("%s (%s) [device %d]", __PRETTY_FUNCTION__, uriP, tunerM.GetId());
+  bool result = false;
+
+  if (!isempty(uriP)) {
+     long rc = 0;
+     cTimeMs processing(0);
+
+     if (Request("TEARDOWN", uriP, NULL))
+        ParseData();
+     cseqM = 1;
+     sessionM[0] = 0;
+
+     result = ValidateLatestResponse(uriP, &rc);
+     dbg_rtsp("%s (%s) Response %ld in %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, uriP, rc, processing.Elapsed(), tunerM.GetId());
+     }
+
+  return result;
+}
+
+void cSatipRtsp::ParseHeader(void)
+{
+  dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  cSatipHeader header(responseM, responseHeaderLengthM);
+
+  if (header.Find("com.ses.streamID")) {
+     int streamid = header.IntValue(-1);
+     if (streamid >= 0)
+        tunerM.SetStreamId(streamid);
+     }
+
+  cSatipSessionHeader session;
+  if (header.Find("Session") && session.Parse(header.Value(), header.ValueLength())) {
+     cSatipHeader::Copy(sessionM, sizeof(sessionM), session.Id(), strlen(session.Id()));
+     tunerM.SetSessionTimeout(session.Id(), (session.Timeout() >= 0) ? session.Timeout() * 1000 : -1);
+     }
+
+  if (header.Find("Transport")) {
+     cSatipTransportHeader transport;
+     bool tcp = false;
+     interleavedRtpIdM = 0;
+     interleavedRtcpIdM = 1;
+     transport.Parse(header.Value(), header.ValueLength());
+     switch (transport.Mode()) {
+       case cSatipTransportHeader::eModeUnicast:
+            modeM = cSatipConfig::eTransportModeUnicast;
+            tunerM.SetupTransport(transport.Rtp(), transport.Rtcp(), NULL, NULL);
+            break;
+       case cSatipTransportHeader::eModeMulticast:
+            modeM = cSatipConfig::eTransportModeMulticast;
+            tunerM.SetupTransport(transport.Rtp(), transport.Rtcp(), transport.Destination(), transport.Source());
+            break;
+       case cSatipTransportHeader::eModeInterleaved:
+            interleavedRtpIdM = transport.Rtp();
+            interleavedRtcpIdM = transport.Rtcp();
+            modeM = cSatipConfig::eTransportModeRtpOverTcp;
+            tunerM.SetupTransport(-1, -1, NULL, NULL);
+            tcp = true;
+            break;
+       default:
+            break;
+       }
+     // Interleaved data is served by the poller from now on
+     cMutexLock MutexLock(&mutexM);
+     if (tcp && !registeredM && (fdM >= 0))
+        registeredM = cSatipPoller::GetInstance()->Register(*this);
+     else if (!tcp && registeredM) {
+        cSatipPoller::GetInstance()->Unregister(*this);
+        registeredM = false;
+        }
+     }
+}
+
+void cSatipRtsp::ParseData(void)
+{
+  dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, tunerM.GetId());
+  if (responseLengthM <= responseHeaderLengthM)
+     return;
+
+  cSatipHeader data(responseM + responseHeaderLengthM, responseLengthM - responseHeaderLengthM);
+
+  if (data.Find("No-More")) {
+     data.CopyValue(errorNoMoreM, sizeof(errorNoMoreM), ';');
+     dbg_parsing("%s No-More: %s [device %d]", __PRETTY_FUNCTION__, errorNoMoreM, tunerM.GetId());
+     }
+  if (data.Find("Out-of-Range")) {
+     data.CopyValue(errorOutOfRangeM, sizeof(errorOutOfRangeM), ';');
+     dbg_parsing("%s Out-of-Range: %s [device %d]", __PRETTY_FUNCTION__, errorOutOfRangeM, tunerM.GetId());
+     }
+  if (data.Find("Check-Syntax")) {
+     data.CopyValue(errorCheckSyntaxM, sizeof(errorCheckSyntaxM), ';');
+     dbg_parsing("%s Check-Syntax: %s [device %d]", __PRETTY_FUNCTION__, errorCheckSyntaxM, tunerM.GetId());
+     }
+}
+
+bool cSatipRtsp::ValidateLatestResponse(const char *uriP, long *rcP)
+{
+  bool result = false;
+  long rc = responseReadyM ? statusCodeM : 0;
+
+  switch (rc) {
+    case 200:
+         result = true;
+         break;
+    case 400:
+         // SETUP PLAY TEARDOWN
+         // The message body of the response may contain the "Check-Syntax:" parameter followed
+         // by the malformed syntax
+         if (!isempty(errorCheckSyntaxM)) {
+            error("Check syntax: %s (error code %ld: %s) [device %d]", errorCheckSyntaxM, rc, uriP, tunerM.GetId());
+            break;
+            }
+    case 403:
+         // SETUP PLAY TEARDOWN
+         // The message body of the response may contain the "Out-of-Range:" parameter followed
+         // by a space-separated list of the attribute names that are not understood:
+         // "src" "fe" "freq" "pol" "msys" "mtype" "plts" "ro" "sr" "fec" "pids" "addpids" "delpids" "mcast"
+         if (!isempty(errorOutOfRangeM)) {
+            error("Out of range: %s (error code %ld: %s) [device %d]", errorOutOfRangeM, rc, uriP, tunerM.GetId());
+            // Reseting the connection wouldn't help anything due to invalid channel configuration, so let it be successful
+            result = true;
+            break;
+            }
+    case 503:
+         // SETUP PLAY
+         // The message body of the response may contain the "No-More:" parameter followed
+         // by a space-separated list of the missing ressources: “sessions” "frontends" "pids
+         if (!isempty(errorNoMoreM)) {
+            error("No more: %s (error code %ld: %s) [device %d]", errorNoMoreM, rc, uriP, tunerM.GetId());
+            break;
+            }
+    default:
+         error("Detected invalid status code %ld: %s [device %d]", rc, uriP, tunerM.GetId());
+         break;
+    }
+  if (rcP)
+     *rcP = rc;
+  errorNoMoreM[0] = 0;
+  errorOutOfRangeM[0] = 0;
+  errorCheckSyntaxM[0] = 0;
+  dbg_funcname("%s result=%s [device %d]", __PRETTY_FUNCTION__, result ? "ok" : "failed", tunerM.GetId());
+
+  return result;
+}
+
+#endif // USE_NATIVE_RTSP
@@ -13,7 +13,9 @@
 #include "device.h"
 #include "discover.h"
 #include "log.h"
+#include "multicast.h"
 #include "poller.h"
+#include "rtsp.h"
 #include "setup.h"
 
 #if defined(LIBCURL_VERSION_NUM) && LIBCURL_VERSION_NUM < 0x072400
@@ -32,7 +34,7 @@ static const char DESCRIPTION[] = trNOOP("SAT>IP Devices");
 /*******************************************************************************
  * class cPluginSatip
  ******************************************************************************/
-cPluginSatip::cPluginSatip(void) : deviceCountM(2), serversM(NULL)
+cPluginSatip::cPluginSatip(void) : deviceCountM(2), serversM(NULL), threadArgsM(false)
 {
   dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
   // Initialize any member variables here.
@@ -44,6 +46,9 @@ cPluginSatip::~cPluginSatip()
 {
   dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
   // Clean up after yourself!
+  // The devices and thus all RTSP handles are gone by now
+  cSatipRtspPool::Destroy();
+  cSatipMulticast::Destroy();
 }
 
 
@@ -68,7 +73,7 @@ const char *cPluginSatip::CommandLineHelp(void)
   // Return a string that describes all known command line options.
   return "  -d <num>, --devices=<number>  set number of devices to be created\n"
          "  -t <mode>, --trace=<mode>     set the debug mode\n"
-         "  -s <ipaddr>|<model>|<desc>, --server=[<srcaddress>@]<ipaddress>[:<port>]|<model>[:<filter>]|<description>[:<quirk>];...\n"
+         "  -s <ipaddr>|<model>|<desc>, --server=[<srcaddress>@]<ipaddress>[:<port>]|<model>[:<filter>]|<description>[:<quirk>[:<pids>]];...\n"
          "                                define hard-coded SAT>IP server(s)\n\n"
          "                                srcaddress (Optional)  Source address can be used to define used\n"
          "                                                       networking interface on a host, e.g. 127.0.0.1.\n"
@@ -93,12 +98,21 @@ const char *cPluginSatip::CommandLineHelp(void)
          "                                                       0x20: Support the CI TNR protocol extension\n"
          "                                                       0x40: Fix auto-detection of pilot tones bug\n"
          "                                                       0x80: Fix re-tuning bug by teardowning a session\n"
+         "                                                      0x100: Support the fast zap sequence\n"
+         "                                pids (Optional)        Maximum number of pids before the whole\n"
+         "                                                       transponder is requested via pids=all.\n"
          "  -D, --detach                  set the detached mode on\n"
          "  -S, --single                  set the single model server mode on\n"
          "  -n, --noquirks                disable autodetection of the server quirks\n"
          "  -p, --portrange=<start>-<end> set a range of ports used for the RT[C]P server\n"
          "                                a minimum of 2 ports per device is required.\n"
-         "  -r, --rcvbuf                  override the size of the RTP receive buffer in bytes\n";
+         "  -r, --rcvbuf                  override the size of the RTP receive buffer in bytes\n"
+         "  -T, --threads=<class>:<cpus>[:<policy>[:<priority>]];...\n"
+         "                                set CPU affinity and scheduling of plugin threads\n\n"
+         "                                class                  Thread class: poller, tuner, section or discover.\n"
+         "                                cpus                   CPU list, e.g. 2-3 or 0,2. Empty keeps the default.\n"
+         "                                policy (Optional)      Scheduling policy: other, fifo or rr.\n"
+         "                                priority (Optional)    Realtime priority 1...99 for fifo and rr.\n";
 }
 
 bool cPluginSatip::ProcessArgs(int argc, char *argv[])
@@ -111,6 +125,7 @@ bool cPluginSatip::ProcessArgs(int argc, char *argv[])
     { "server",   required_argument, NULL, 's' },
     { "portrange",required_argument, NULL, 'p' },
     { "rcvbuf",   required_argument, NULL, 'r' },
+    { "threads",  required_argument, NULL, 'T' },
     { "detach",   no_argument,       NULL, 'D' },
     { "single",   no_argument,       NULL, 'S' },
     { "noquirks", no_argument,       NULL, 'n' },
@@ -120,7 +135,7 @@ bool cPluginSatip::ProcessArgs(int argc, char *argv[])
   cString server;
   cString portrange;
   int c;
-  while ((c = getopt_long(argc, argv, "d:t:s:p:r:DSn", long_options, NULL)) != -1) {
+  while ((c = getopt_long(argc, argv, "d:t:s:p:r:T:DSn", long_options, NULL)) != -1) {
     switch (c) {
       case 'd':
            deviceCountM = strtol(optarg, NULL, 0);
@@ -146,6 +161,10 @@ bool cPluginSatip::ProcessArgs(int argc, char *argv[])
       case 'r':
            SatipConfig.SetRtpRcvBufSize(strtol(optarg, NULL, 0));
            break;
+      case 'T':
+           ParseThreads(optarg);
+           threadArgsM = true;
+           break;
       default:
            return false;
       }
@@ -165,7 +184,7 @@ bool cPluginSatip::Initialize(void)
   if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
      error("Unable to initialize CURL");
   cSatipPoller::GetInstance()->Initialize();
-  cSatipDiscover::GetInstance()->Initialize(serversM);
+  cSatipDiscover::GetInstance()->Initialize(serversM, ConfigDirectory(PLUGIN_NAME_I18N));
   return cSatipDevice::Initialize(deviceCountM);
 }
 
@@ -246,6 +265,7 @@ void cPluginSatip::ParseServer(const char *paramP)
         dbg_parsing("%s server[%d]=%s", __PRETTY_FUNCTION__, n, r);
         cString sourceAddr, serverAddr, serverModel, serverFilters, serverDescription;
         int serverQuirk = cSatipServer::eSatipQuirkNone;
+        int serverPidLimit = 0;
         int serverPort = SATIP_DEFAULT_RTSP_PORT;
         int n2 = 0;
         char *s2, *p2 = r;
@@ -284,7 +304,10 @@ void cPluginSatip::ParseServer(const char *paramP)
                           serverDescription = r2;
                           char *r3 = strchr(r2, ':');
                           if (r3) {
-                             serverQuirk = strtol(r3 + 1, NULL, 0);
+                             char *r4 = NULL;
+                             serverQuirk = strtol(r3 + 1, &r4, 0);
+                             if (r4 && (*r4 == ':'))
+                                serverPidLimit = strtol(r4 + 1, NULL, 0);
                              serverDescription = serverDescription.Truncate(r3 - r2);
                              }
                           }
@@ -295,10 +318,10 @@ void cPluginSatip::ParseServer(const char *paramP)
               r2 = strtok_r(NULL, "|", &s2);
               }
         if (*serverAddr && *serverModel && *serverDescription) {
-           dbg_funcname("%s srcaddr=%s ipaddr=%s port=%d model=%s (%s) desc=%s (%d)", __PRETTY_FUNCTION__, *sourceAddr, *serverAddr, serverPort, *serverModel, *serverFilters, *serverDescription, serverQuirk);
+           dbg_funcname("%s srcaddr=%s ipaddr=%s port=%d model=%s (%s) desc=%s (%d, %d)", __PRETTY_FUNCTION__, *sourceAddr, *serverAddr, serverPort, *serverModel, *serverFilters, *serverDescription, serverQuirk, serverPidLimit);
            if (!serversM)
               serversM = new cSatipDiscoverServers();
-           serversM->Add(new cSatipDiscoverServer(*sourceAddr, *serverAddr, serverPort, *serverModel, *serverFilters, *serverDescription, serverQuirk));
+           serversM->Add(new cSatipDiscoverServer(*sourceAddr, *serverAddr, serverPort, *serverModel, *serverFilters, *serverDescription, serverQuirk, serverPidLimit));
            }
         ++n;
         r = strtok_r(NULL, ";", &s);
@@ -337,6 +360,55 @@ void cPluginSatip::ParsePortRange(const char *paramP)
   SatipConfig.SetPortRangeStop(rangeStop);
 }
 
+void cPluginSatip::ParseThreads(const char *paramP)
+{
+  dbg_funcname("%s (%s)", __PRETTY_FUNCTION__, paramP);
+  char *s, *p = strdup(paramP);
+  char *r = strtok_r(p, ";", &s);
+  while (r) {
+        r = skipspace(r);
+        dbg_parsing("%s thread=%s", __PRETTY_FUNCTION__, r);
+        char *s2;
+        char *name = strtok_r(r, ":", &s2);
+        unsigned int threadClass = 0;
+        while (name && (threadClass < SATIP_THREAD_CLASS_COUNT) && strcasecmp(name, thread_class_table[threadClass]))
+              ++threadClass;
+        if (!name || (threadClass >= SATIP_THREAD_CLASS_COUNT)) {
+           error("Unknown thread class '%s'", name ? name : "");
+           }
+        else {
+           // the cpu list may be empty, so strtok_r() can't be used here
+           char *cpus = s2;
+           char *policy = cpus ? strchr(cpus, ':') : NULL;
+           if (policy)
+              *policy++ = 0;
+           char *priority = policy ? strchr(policy, ':') : NULL;
+           if (priority)
+              *priority++ = 0;
+           cpu_set_t set;
+           if (!isempty(cpus) && !ParseCpuList(cpus, &set)) {
+              error("Invalid CPU list '%s' for %s threads", cpus, thread_class_table[threadClass]);
+              }
+           else
+              SatipConfig.SetThreadCpus(threadClass, cpus);
+           if (!isempty(policy)) {
+              unsigned int threadPolicy = 0;
+              while ((threadPolicy < cSatipConfig::eThreadPolicyCount) && strcasecmp(policy, thread_policy_table[threadPolicy]))
+                    ++threadPolicy;
+              if (threadPolicy < cSatipConfig::eThreadPolicyCount)
+                 SatipConfig.SetThreadPolicy(threadClass, threadPolicy);
+              else {
+                 error("Unknown scheduling policy '%s' for %s threads", policy, thread_class_table[threadClass]);
+                 }
+              }
+           if (!isempty(priority))
+              SatipConfig.SetThreadPriority(threadClass, strtol(priority, NULL, 0));
+           }
+        r = strtok_r(NULL, ";", &s);
+        }
+  FREE_POINTER(p);
+}
+
 int cPluginSatip::ParseCicams(const char *valueP, int *cicamsP)
 {
   dbg_funcname("%s (%s,)", __PRETTY_FUNCTION__, valueP);
@@ -400,6 +472,18 @@ bool cPluginSatip::SetupParse(const char *nameP, const char *valueP)
      SatipConfig.SetCIExtension(atoi(valueP));
   else if (!strcasecmp(nameP, "EnableFrontendReuse"))
      SatipConfig.SetFrontendReuse(atoi(valueP));
+  else if (!strcasecmp(nameP, "EnablePreTuning"))
+     SatipConfig.SetPreTuning(atoi(valueP));
+  else if (!strcasecmp(nameP, "ServerSelection"))
+     SatipConfig.SetServerSelection(atoi(valueP));
+  else if (!strcasecmp(nameP, "PidUpdateWindow"))
+     SatipConfig.SetPidUpdateWindow(atoi(valueP));
+  else if (!strcasecmp(nameP, "PidLimit"))
+     SatipConfig.SetPidLimit(atoi(valueP));
+  else if (!strcasecmp(nameP, "MsearchCount"))
+     SatipConfig.SetMsearchCount(atoi(valueP));
+  else if (!strcasecmp(nameP, "MsearchMx"))
+     SatipConfig.SetMsearchMx(atoi(valueP));
   else if (!strcasecmp(nameP, "CICAM")) {
      int Cicams[MAX_CICAM_COUNT];
      for (unsigned int i = 0; i < ELEMENTS(Cicams); ++i)
@@ -428,6 +512,11 @@ bool cPluginSatip::SetupParse(const char *nameP, const char *valueP)
      }
   else if (!strcasecmp(nameP, "TransportMode"))
      SatipConfig.SetTransportMode(atoi(valueP));
+  else if (!strcasecmp(nameP, "Threads")) {
+     // command-line parameters override the stored values
+     if (!threadArgsM)
+        ParseThreads(valueP);
+     }
   else
      return false;
   return true;
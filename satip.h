@@ -19,8 +19,10 @@ class cPluginSatip : public cPlugin {
 private:
   unsigned int deviceCountM;
   cSatipDiscoverServers *serversM;
+  bool threadArgsM;
   void ParseServer(const char *paramP);
   void ParsePortRange(const char *paramP);
+  void ParseThreads(const char *paramP);
   int ParseCicams(const char *valueP, int *cicamsP);
   int ParseSources(const char *valueP, int *sourcesP);
   int ParseFilters(const char *valueP, int *filtersP);
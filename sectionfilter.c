@@ -307,6 +307,7 @@ void cSatipSectionFilterHandler::SendAll(void)
 void cSatipSectionFilterHandler::Action(void)
 {
   dbg_funcname("%s Entering [device %d]", __PRETTY_FUNCTION__, deviceIndexM);
+  SetThreadScheduling(SATIP_THREAD_SECTION);
   // Do the thread loop
   while (Running()) {
         uchar *p = NULL;
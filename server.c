@@ -5,6 +5,7 @@
  *
  */
 
+#include <inttypes.h>
 #include <vdr/sources.h>
 
 #include "config.h"
@@ -14,41 +15,210 @@
 
 // --- cSatipFrontend ---------------------------------------------------------
 
-cSatipFrontend::cSatipFrontend(const int indexP, const char *descriptionP)
-: indexM(indexP),
+cSatipFrontend::cSatipFrontend()
+: indexM(0),
   transponderM(0),
   deviceIdM(-1),
-  descriptionM(descriptionP)
+  reservedIdM(-1),
+  reservationM(),
+  descriptionM("")
 {
 }
 
-cSatipFrontend::~cSatipFrontend()
+// --- cSatipFrontends --------------------------------------------------------
+
+cSatipFrontends::cSatipFrontends()
+: countM(0),
+  attachedM(0),
+  reservedM(0),
+  usedSlotsM(0)
 {
+  memset(systemsM, 0, sizeof(systemsM));
+  for (int i = 0; i < SATIP_MAX_DEVICES; ++i)
+      attachedByM[i] = reservedByM[i] = -1;
+  memset(transpondersM, 0, sizeof(transpondersM));
 }
 
-// --- cSatipFrontends --------------------------------------------------------
+int cSatipFrontends::Slot(int transponderP, bool addP)
+{
+  // Open addressing without deletions: emptied slots stay until the next rebuild
+  unsigned int hash = (unsigned int)transponderP * 2654435761U;
+  for (int i = 0; i < eTransponderSlots; ++i) {
+      int slot = (hash + i) & (eTransponderSlots - 1);
+      if (!transpondersM[slot].used) {
+         if (!addP)
+            return -1;
+         if (usedSlotsM >= eTransponderSlots * 3 / 4) {
+            RebuildSlots();
+            return Slot(transponderP, addP);
+            }
+         transpondersM[slot].used = true;
+         transpondersM[slot].transponder = transponderP;
+         transpondersM[slot].frontends = 0;
+         ++usedSlotsM;
+         return slot;
+         }
+      if (transpondersM[slot].transponder == transponderP)
+         return slot;
+      }
+  return -1;
+}
+
+void cSatipFrontends::RebuildSlots(void)
+{
+  // There are never more transponders in use than frontends
+  memset(transpondersM, 0, sizeof(transpondersM));
+  usedSlotsM = 0;
+  for (int i = 0; i < countM; ++i) {
+      int slot = Slot(frontendsM[i].Transponder(), true);
+      if (slot >= 0)
+         transpondersM[slot].frontends |= Bit(i);
+      }
+}
+
+uint64_t cSatipFrontends::Tuned(int transponderP)
+{
+  int slot = Slot(transponderP, false);
+  return (slot >= 0) ? transpondersM[slot].frontends : 0;
+}
+
+void cSatipFrontends::ExpireReservations(uint64_t maskP)
+{
+  for (uint64_t bits = reservedM & maskP; bits; bits &= bits - 1) {
+      int i = __builtin_ctzll(bits);
+      if (!frontendsM[i].Reserved(-1))
+         reservedM &= ~Bit(i);
+      }
+}
+
+void cSatipFrontends::SetTransponder(int indexP, int transponderP)
+{
+  cSatipFrontend &f = frontendsM[indexP];
+  if (f.Transponder() == transponderP)
+     return;
+  int slot = Slot(f.Transponder(), false);
+  if (slot >= 0)
+     transpondersM[slot].frontends &= ~Bit(indexP);
+  f.SetTransponder(transponderP);
+  slot = Slot(transponderP, true);
+  if (slot >= 0)
+     transpondersM[slot].frontends |= Bit(indexP);
+}
+
+void cSatipFrontends::AttachFrontend(int indexP, int deviceIdP)
+{
+  cSatipFrontend &f = frontendsM[indexP];
+  if (IsDevice(f.DeviceId()) && (attachedByM[f.DeviceId()] == indexP))
+     attachedByM[f.DeviceId()] = -1;
+  if (IsDevice(f.ReservedId()) && (reservedByM[f.ReservedId()] == indexP))
+     reservedByM[f.ReservedId()] = -1;
+  f.Attach(deviceIdP);
+  attachedM |= Bit(indexP);
+  reservedM &= ~Bit(indexP);
+  if (IsDevice(deviceIdP))
+     attachedByM[deviceIdP] = indexP;
+  dbg_chan_switch("%s (%d, %d) %s/#%d", __PRETTY_FUNCTION__, deviceIdP, f.Transponder(), f.Description(), f.Index());
+}
+
+void cSatipFrontends::DetachFrontend(int indexP, int deviceIdP)
+{
+  cSatipFrontend &f = frontendsM[indexP];
+  f.Detach(deviceIdP);
+  if (!f.Attached())
+     attachedM &= ~Bit(indexP);
+  if (f.ReservedId() < 0)
+     reservedM &= ~Bit(indexP);
+  if (IsDevice(deviceIdP)) {
+     if (attachedByM[deviceIdP] == indexP)
+        attachedByM[deviceIdP] = -1;
+     if (reservedByM[deviceIdP] == indexP)
+        reservedByM[deviceIdP] = -1;
+     }
+  dbg_chan_switch("%s (%d, %d) %s/#%d", __PRETTY_FUNCTION__, deviceIdP, f.Transponder(), f.Description(), f.Index());
+}
 
-bool cSatipFrontends::Matches(int deviceIdP, int transponderP)
+void cSatipFrontends::ReserveFrontend(int indexP, int deviceIdP)
 {
-  for (cSatipFrontend *f = First(); f; f = Next(f)) {
-      if (f->Attached() && (f->DeviceId() == deviceIdP) && (f->Transponder() == transponderP))
+  cSatipFrontend &f = frontendsM[indexP];
+  if (IsDevice(f.ReservedId()) && (reservedByM[f.ReservedId()] == indexP))
+     reservedByM[f.ReservedId()] = -1;
+  f.Reserve(deviceIdP);
+  reservedM |= Bit(indexP);
+  if (IsDevice(deviceIdP))
+     reservedByM[deviceIdP] = indexP;
+}
+
+int cSatipFrontends::Own(int systemP, int deviceIdP)
+{
+  if (IsDevice(deviceIdP)) {
+     int i = attachedByM[deviceIdP];
+     if ((i >= 0) && (Mask(systemP) & Bit(i)) && (frontendsM[i].DeviceId() == deviceIdP))
+        return i;
+     }
+  return -1;
+}
+
+bool cSatipFrontends::Add(int systemP, const char *descriptionP)
+{
+  if ((countM >= eMaxFrontends) || (systemP < 0) || (systemP >= eMaxSystems))
+     return false;
+  frontendsM[countM].Set(Count(systemP) + 1, descriptionP);
+  systemsM[systemP] |= Bit(countM);
+  int slot = Slot(frontendsM[countM].Transponder(), true);
+  if (slot >= 0)
+     transpondersM[slot].frontends |= Bit(countM);
+  ++countM;
+  return true;
+}
+
+int cSatipFrontends::Unused(int systemP, int deviceIdP)
+{
+  // The own frontend is retuned first, then any free one not being tuned by other devices
+  int own = Own(systemP, deviceIdP);
+  if (own >= 0)
+     return own;
+  if (IsDevice(deviceIdP)) {
+     int i = reservedByM[deviceIdP];
+     if ((i >= 0) && (Mask(systemP) & Bit(i)) && !frontendsM[i].Attached() && (frontendsM[i].ReservedId() == deviceIdP))
+        return i;
+     }
+  uint64_t mask = Mask(systemP) & ~attachedM;
+  if (mask & ~reservedM)
+     return __builtin_ctzll(mask & ~reservedM);
+  ExpireReservations(mask);
+  for (uint64_t bits = mask; bits; bits &= bits - 1) {
+      int i = __builtin_ctzll(bits);
+      if (!frontendsM[i].Reserved(deviceIdP))
+         return i;
+      }
+  return -1;
+}
+
+int cSatipFrontends::Busy(int systemP)
+{
+  uint64_t mask = Mask(systemP);
+  ExpireReservations(mask);
+  return __builtin_popcountll(mask & (attachedM | reservedM));
+}
+
+bool cSatipFrontends::Matches(int systemP, int deviceIdP, int transponderP)
+{
+  int own = Own(systemP, deviceIdP);
+  if ((own >= 0) && (frontendsM[own].Transponder() == transponderP))
+     return true;
+  for (uint64_t bits = Tuned(transponderP) & Mask(systemP) & attachedM; bits; bits &= bits - 1) {
+      if (frontendsM[__builtin_ctzll(bits)].DeviceId() == deviceIdP)
          return true;
       }
   return false;
 }
 
-bool cSatipFrontends::Assign(int deviceIdP, int transponderP)
+bool cSatipFrontends::Assign(int systemP, int deviceIdP, int transponderP)
 {
-  cSatipFrontend *tmp = NULL;
-  // Prefer any unused one
-  for (cSatipFrontend *f = First(); f; f = Next(f)) {
-      if (!f->Attached() || (f->DeviceId() == deviceIdP)) {
-         tmp = f;
-         break;
-         }
-      }
-  if (tmp) {
-     tmp->SetTransponder(transponderP);
+  int i = Unused(systemP, deviceIdP);
+  if (i >= 0) {
+     SetTransponder(i, transponderP);
+     ReserveFrontend(i, deviceIdP);
      return true;
      }
   return false;
@@ -56,10 +226,18 @@ bool cSatipFrontends::Assign(int deviceIdP, int transponderP)
 
 bool cSatipFrontends::Attach(int deviceIdP, int transponderP)
 {
-  for (cSatipFrontend *f = First(); f; f = Next(f)) {
-      if (f->Transponder() == transponderP) {
-         f->Attach(deviceIdP);
-         dbg_chan_switch("%s (%d, %d) %s/#%d", __PRETTY_FUNCTION__, deviceIdP, transponderP, *f->Description(), f->Index());
+  // Prefer the frontend reserved for this device
+  if (IsDevice(deviceIdP)) {
+     int i = reservedByM[deviceIdP];
+     if ((i >= 0) && (frontendsM[i].ReservedId() == deviceIdP) && (frontendsM[i].Transponder() == transponderP)) {
+        AttachFrontend(i, deviceIdP);
+        return true;
+        }
+     }
+  for (uint64_t bits = Tuned(transponderP); bits; bits &= bits - 1) {
+      int i = __builtin_ctzll(bits);
+      if (!frontendsM[i].Reserved(deviceIdP)) {
+         AttachFrontend(i, deviceIdP);
          return true;
          }
       }
@@ -68,10 +246,20 @@ bool cSatipFrontends::Attach(int deviceIdP, int transponderP)
 
 bool cSatipFrontends::Detach(int deviceIdP, int transponderP)
 {
-  for (cSatipFrontend *f = First(); f; f = Next(f)) {
-      if (f->Transponder() == transponderP) {
-         f->Detach(deviceIdP);
-         dbg_chan_switch("%s (%d, %d) %s/#%d", __PRETTY_FUNCTION__, deviceIdP, transponderP, *f->Description(), f->Index());
+  if (IsDevice(deviceIdP)) {
+     int candidates[] = { attachedByM[deviceIdP], reservedByM[deviceIdP] };
+     for (unsigned int j = 0; j < ELEMENTS(candidates); ++j) {
+         int i = candidates[j];
+         if ((i >= 0) && (frontendsM[i].Transponder() == transponderP) && ((frontendsM[i].DeviceId() == deviceIdP) || (frontendsM[i].ReservedId() == deviceIdP))) {
+            DetachFrontend(i, deviceIdP);
+            return true;
+            }
+         }
+     }
+  for (uint64_t bits = Tuned(transponderP); bits; bits &= bits - 1) {
+      int i = __builtin_ctzll(bits);
+      if ((frontendsM[i].DeviceId() == deviceIdP) || (frontendsM[i].ReservedId() == deviceIdP)) {
+         DetachFrontend(i, deviceIdP);
          return true;
          }
       }
@@ -80,7 +268,7 @@ bool cSatipFrontends::Detach(int deviceIdP, int transponderP)
 
 // --- cSatipServer -----------------------------------------------------------
 
-cSatipServer::cSatipServer(const char *srcAddressP, const char *addressP, const int portP, const char *modelP, const char *filtersP, const char *descriptionP, const int quirkP)
+cSatipServer::cSatipServer(const char *srcAddressP, const char *addressP, const int portP, const char *modelP, const char *filtersP, const char *descriptionP, const int quirkP, const int pidLimitP)
 : srcAddressM((srcAddressP && *srcAddressP) ? srcAddressP : ""),
   addressM((addressP && *addressP) ? addressP : "0.0.0.0"),
   modelM((modelP && *modelP) ? modelP : "DVBS-1"),
@@ -89,10 +277,25 @@ cSatipServer::cSatipServer(const char *srcAddressP, const char *addressP, const
   quirksM(""),
   portM(portP),
   quirkM(quirkP),
+  pidLimitM(pidLimitP),
   hasCiM(false),
   activeM(true),
+  verifiedM(true),
+  errorsM(0),
+  errorTimeM(0),
+  healthM(eHealthOk),
+  failuresM(0),
+  backoffMsM(eHealthMinBackoffMs),
+  openedM(0),
+  probingM(false),
+  probeDeviceM(-1),
+  probeM(0),
   createdM(time(NULL)),
-  lastSeenM(0)
+  lastSeenM(0),
+  zapTimeM(0),
+  zapTimeSumM(0),
+  zapCountM(0),
+  savedRequestsM(0)
 {
   memset(sourceFiltersM, 0, sizeof(sourceFiltersM));
   if (!isempty(*filtersM)) {
@@ -161,6 +364,10 @@ cSatipServer::cSatipServer(const char *srcAddressP, const char *addressP, const
          strstr(*descriptionM, "fritzdvbc")                    // FRITZ!WLAN Repeater DVB-C (old firmware)
         )
         quirkM |= eSatipQuirkTearAndPlay;
+     // These devices accept pids in SETUP and report the lock via RTCP:
+     if (strstr(*descriptionM, "minisatip")                    // minisatip server
+        )
+        quirkM |= eSatipQuirkFastZap;
      }
   if ((quirkM & eSatipQuirkMask) & eSatipQuirkSessionId)
      quirksM = cString::sprintf("%s%sSessionId", *quirksM, isempty(*quirksM) ? "" : ",");
@@ -176,6 +383,8 @@ cSatipServer::cSatipServer(const char *srcAddressP, const char *addressP, const
      quirksM = cString::sprintf("%s%sCiTnr", *quirksM, isempty(*quirksM) ? "" : ",");
   if ((quirkM & eSatipQuirkMask) & eSatipQuirkForcePilot)
      quirksM = cString::sprintf("%s%sForcePilot", *quirksM, isempty(*quirksM) ? "" : ",");
+  if ((quirkM & eSatipQuirkMask) & eSatipQuirkFastZap)
+     quirksM = cString::sprintf("%s%sFastZap", *quirksM, isempty(*quirksM) ? "" : ",");
   dbg_parsing("%s description=%s quirks=%s", __PRETTY_FUNCTION__, *descriptionM, *quirksM);
   // These devices support external CI
   if (strstr(*descriptionM, "OctopusNet") ||            // Digital Devices OctopusNet
@@ -189,34 +398,22 @@ cSatipServer::cSatipServer(const char *srcAddressP, const char *addressP, const
   while (r) {
         char *c;
         if (c = strstr(r, "DVBS2-")) {
-           int count = atoi(c + 6);
-           for (int i = 1; i <= count; ++i)
-               frontendsM[delsysDVBS2].Add(new cSatipFrontend(i, "DVB-S2"));
+           AddFrontends(delsysDVBS2, "DVB-S2", atoi(c + 6));
            }
         else if (c = strstr(r, "DVBT-")) {
-           int count = atoi(c + 5);
-           for (int i = 1; i <= count; ++i)
-               frontendsM[delsysDVBT].Add(new cSatipFrontend(i, "DVB-T"));
+           AddFrontends(delsysDVBT, "DVB-T", atoi(c + 5));
            }
         else if (c = strstr(r, "DVBT2-")) {
-           int count = atoi(c + 6);
-           for (int i = 1; i <= count; ++i)
-               frontendsM[delsysDVBT2].Add(new cSatipFrontend(i, "DVB-T2"));
+           AddFrontends(delsysDVBT2, "DVB-T2", atoi(c + 6));
            }
         else if (c = strstr(r, "DVBC-")) {
-           int count = atoi(c + 5);
-           for (int i = 1; i <= count; ++i)
-               frontendsM[delsysDVBC].Add(new cSatipFrontend(i, "DVB-C"));
+           AddFrontends(delsysDVBC, "DVB-C", atoi(c + 5));
            }
         else if (c = strstr(r, "DVBC2-")) {
-           int count = atoi(c + 6);
-           for (int i = 1; i <= count; ++i)
-               frontendsM[delsysDVBC2].Add(new cSatipFrontend(i, "DVB-C2"));
+           AddFrontends(delsysDVBC2, "DVB-C2", atoi(c + 6));
            }
         else if (c = strstr(r, "ATSC-")) {
-           int count = atoi(c + 5);
-           for (int i = 1; i <= count; ++i)
-               frontendsM[delsysATSC].Add(new cSatipFrontend(i, "ATSC"));
+           AddFrontends(delsysATSC, "ATSC", atoi(c + 5));
            }
         r = strtok_r(NULL, ",", &s);
         }
@@ -258,21 +455,21 @@ bool cSatipServer::Assign(int DeviceId, int Source, int DelSys, int Transponder)
 
   switch((char) (Source >> 24)) {
      case 'S':
-        return frontendsM[delsysDVBS2].Assign(DeviceId, Transponder);
+        return frontendsM.Assign(delsysDVBS2, DeviceId, Transponder);
      case 'T':
         if (DelSys != 0)
-           return frontendsM[delsysDVBT2].Assign(DeviceId, Transponder);
+           return frontendsM.Assign(delsysDVBT2, DeviceId, Transponder);
         else
-           return frontendsM[delsysDVBT].Assign(DeviceId, Transponder) ||
-                  frontendsM[delsysDVBT2].Assign(DeviceId, Transponder);
+           return frontendsM.Assign(delsysDVBT, DeviceId, Transponder) ||
+                  frontendsM.Assign(delsysDVBT2, DeviceId, Transponder);
      case 'C':
         if (DelSys != 0)
-           return frontendsM[delsysDVBC2].Assign(DeviceId, Transponder);
+           return frontendsM.Assign(delsysDVBC2, DeviceId, Transponder);
         else
-           return frontendsM[delsysDVBC].Assign(DeviceId, Transponder) ||
-                  frontendsM[delsysDVBC2].Assign(DeviceId, Transponder);
+           return frontendsM.Assign(delsysDVBC, DeviceId, Transponder) ||
+                  frontendsM.Assign(delsysDVBC2, DeviceId, Transponder);
      case 'A':
-        return frontendsM[delsysATSC].Assign(DeviceId, Transponder);
+        return frontendsM.Assign(delsysATSC, DeviceId, Transponder);
      default:;
      }
   return false;
@@ -282,6 +479,10 @@ bool cSatipServer::Matches(int Source) {
   if (not IsValidSource(Source))
      return false;
 
+  return ProvidesType(Source);
+}
+
+bool cSatipServer::ProvidesType(int Source) {
   switch((char) (Source >> 24)) {
      case 'S':
         return GetModulesDVBS2();
@@ -302,69 +503,213 @@ bool cSatipServer::Matches(int DeviceId, int Source, int DelSys, int Transponder
 
   switch((char) (Source >> 24)) {
      case 'S':
-        return frontendsM[delsysDVBS2].Matches(DeviceId, Transponder);
+        return frontendsM.Matches(delsysDVBS2, DeviceId, Transponder);
      case 'T':
         if (DelSys != 0)
-           return frontendsM[delsysDVBT2].Matches(DeviceId, Transponder);
+           return frontendsM.Matches(delsysDVBT2, DeviceId, Transponder);
         else
-           return frontendsM[delsysDVBT].Matches(DeviceId, Transponder) ||
-                  frontendsM[delsysDVBT2].Matches(DeviceId, Transponder);
+           return frontendsM.Matches(delsysDVBT, DeviceId, Transponder) ||
+                  frontendsM.Matches(delsysDVBT2, DeviceId, Transponder);
      case 'C':
         if (DelSys != 0)
-           return frontendsM[delsysDVBC2].Matches(DeviceId, Transponder);
+           return frontendsM.Matches(delsysDVBC2, DeviceId, Transponder);
         else
-           return frontendsM[delsysDVBC].Matches(DeviceId, Transponder) ||
-                  frontendsM[delsysDVBC2].Matches(DeviceId, Transponder);
+           return frontendsM.Matches(delsysDVBC, DeviceId, Transponder) ||
+                  frontendsM.Matches(delsysDVBC2, DeviceId, Transponder);
      case 'A':
-        return frontendsM[delsysATSC].Matches(DeviceId, Transponder);
+        return frontendsM.Matches(delsysATSC, DeviceId, Transponder);
      }
   return false;
 }
 
-void cSatipServer::Attach(int deviceIdP, int transponderP)
+int cSatipServer::Systems(int sourceP, int delsysP, int *systemsP)
 {
-  for (int i = 0; i < delsysCount; ++i) {
-      if (frontendsM[i].Attach(deviceIdP, transponderP))
-         return;
+  switch ((char)(sourceP >> 24)) {
+     case 'S':
+        systemsP[0] = delsysDVBS2;
+        return 1;
+     case 'T':
+        if (delsysP != 0) {
+           systemsP[0] = delsysDVBT2;
+           return 1;
+           }
+        systemsP[0] = delsysDVBT;
+        systemsP[1] = delsysDVBT2;
+        return 2;
+     case 'C':
+        if (delsysP != 0) {
+           systemsP[0] = delsysDVBC2;
+           return 1;
+           }
+        systemsP[0] = delsysDVBC;
+        systemsP[1] = delsysDVBC2;
+        return 2;
+     case 'A':
+        systemsP[0] = delsysATSC;
+        return 1;
+     default:;
+     }
+  return 0;
+}
+
+bool cSatipServer::CanAssign(int deviceIdP, int sourceP, int delsysP)
+{
+  if (!IsValidSource(sourceP))
+     return false;
+  int systems[2];
+  int n = Systems(sourceP, delsysP, systems);
+  for (int i = 0; i < n; ++i) {
+      if (frontendsM.Unused(systems[i], deviceIdP) >= 0)
+         return true;
       }
+  return false;
 }
 
-void cSatipServer::Detach(int deviceIdP, int transponderP)
+int cSatipServer::Score(int sourceP, int delsysP)
+{
+  int systems[2];
+  int n = Systems(sourceP, delsysP, systems);
+  int busy = 0, count = 0;
+  for (int i = 0; i < n; ++i) {
+      busy += frontendsM.Busy(systems[i]);
+      count += frontendsM.Count(systems[i]);
+      }
+  int score = count ? (busy * eScoreLoad / count) : eScoreLoad;
+  score += Errors() * eScoreError;
+  if (zapCountM)
+     score += (int)(min(zapTimeSumM / zapCountM, (uint64_t)eScoreMaxZapTime) / 10);
+  // A source given explicitly in the filters is most likely wired best there
+  if (sourceFiltersM[0])
+     score -= eScoreAffinity;
+  return score;
+}
+
+void cSatipServer::AddFrontends(int delsysP, const char *descriptionP, int countP)
 {
-  for (int i = 0; i < delsysCount; ++i) {
-      if (frontendsM[i].Detach(deviceIdP, transponderP))
-         return;
+  for (int i = 0; i < countP; ++i) {
+      if (!frontendsM.Add(delsysP, descriptionP)) {
+         error("Too many frontends in %s (%s %s)", *descriptionM, *addressM, *modelM);
+         break;
+         }
       }
 }
 
+void cSatipServer::Attach(int deviceIdP, int transponderP)
+{
+  frontendsM.Attach(deviceIdP, transponderP);
+}
+
+void cSatipServer::Detach(int deviceIdP, int transponderP)
+{
+  frontendsM.Detach(deviceIdP, transponderP);
+}
+
+void cSatipServer::Open(void)
+{
+  healthM = eHealthOpen;
+  probingM = false;
+  probeDeviceM = -1;
+  openedM.Set();
+  info("Server %s (%s %s) failing, retrying in %u s", *descriptionM, *addressM, *modelM, backoffMsM / 1000);
+}
+
+void cSatipServer::AddError(void)
+{
+  if (errorTimeM.TimedOut())
+     errorsM = 0;
+  ++errorsM;
+  errorTimeM.Set(eErrorWindowMs);
+  ++failuresM;
+  if (healthM != eHealthOk) {
+     // The server is still failing after or during the backoff, so back off even longer
+     backoffMsM = min(backoffMsM * 2, (unsigned int)eHealthMaxBackoffMs);
+     Open();
+     }
+  else if ((healthM == eHealthOk) && (failuresM >= eHealthMaxFailures))
+     Open();
+}
+
+void cSatipServer::AddSuccess(void)
+{
+  if (healthM != eHealthOk)
+     info("Server %s (%s %s) recovered", *descriptionM, *addressM, *modelM);
+  healthM = eHealthOk;
+  failuresM = 0;
+  backoffMsM = eHealthMinBackoffMs;
+  probingM = false;
+  probeDeviceM = -1;
+}
+
+bool cSatipServer::IsBlocked(int deviceIdP)
+{
+  // After the backoff only the device probing the server may use it until the probe has a result
+  if ((healthM == eHealthOpen) && (openedM.Elapsed() >= backoffMsM))
+     healthM = eHealthHalfOpen;
+  if (healthM == eHealthHalfOpen)
+     return probingM && !probeM.TimedOut() && (probeDeviceM != deviceIdP);
+  return (healthM == eHealthOpen);
+}
+
+bool cSatipServer::Probe(int deviceIdP)
+{
+  if (IsBlocked(deviceIdP))
+     return false;
+  StartProbe(deviceIdP);
+  return true;
+}
+
+cString cSatipServer::GetHealthString(void)
+{
+  switch (healthM) {
+    case eHealthOpen:
+         if (openedM.Elapsed() < backoffMsM)
+            return cString::sprintf("open (retry in %u s, %u failures)", (unsigned int)((backoffMsM - openedM.Elapsed()) / 1000), failuresM);
+         return cString::sprintf("open (%u failures)", failuresM);
+    case eHealthHalfOpen:
+         return cString::sprintf("half-open (%u failures)", failuresM);
+    default:
+         break;
+    }
+  if (failuresM)
+     return cString::sprintf("ok (%u failures)", failuresM);
+  return "ok";
+}
+
+cString cSatipServer::GetZapStatistic(void)
+{
+  if (!zapCountM)
+     return "---";
+  return cString::sprintf("%" PRIu64 " ms (avg %" PRIu64 " ms, %u zaps)", zapTimeM, zapTimeSumM / zapCountM, zapCountM);
+}
+
 int cSatipServer::GetModulesDVBS2(void)
 {
-  return frontendsM[delsysDVBS2].Count();
+  return frontendsM.Count(delsysDVBS2);
 }
 
 int cSatipServer::GetModulesDVBT(void)
 {
-  return frontendsM[delsysDVBT].Count();
+  return frontendsM.Count(delsysDVBT);
 }
 
 int cSatipServer::GetModulesDVBT2(void)
 {
-  return frontendsM[delsysDVBT2].Count();
+  return frontendsM.Count(delsysDVBT2);
 }
 
 int cSatipServer::GetModulesDVBC(void)
 {
-  return frontendsM[delsysDVBC].Count();
+  return frontendsM.Count(delsysDVBC);
 }
 
 int cSatipServer::GetModulesDVBC2(void)
 {
-  return frontendsM[delsysDVBC2].Count();
+  return frontendsM.Count(delsysDVBC2);
 }
 
 int cSatipServer::GetModulesATSC(void)
 {
-  return frontendsM[delsysATSC].Count();
+  return frontendsM.Count(delsysATSC);
 }
 
 // --- cSatipServers ----------------------------------------------------------
@@ -390,12 +735,33 @@ cSatipServer *cSatipServers::Find(int sourceP)
 cSatipServer *cSatipServers::Assign(int deviceIdP, int sourceP, int transponderP, int systemP)
 {
   for (cSatipServer *s = First(); s; s = Next(s)) {
-      if (s->IsActive() && s->Matches(deviceIdP, sourceP, systemP, transponderP))
+      if (s->IsActive() && !s->IsBlocked(deviceIdP) && s->Matches(deviceIdP, sourceP, systemP, transponderP))
          return s;
       }
+  // New frontends are taken only from servers not failing at the moment
+  if (SatipConfig.GetServerSelection() == cSatipConfig::eServerSelectionLeastLoaded) {
+     cSatipServer *best = NULL;
+     int bestScore = 0;
+     for (cSatipServer *s = First(); s; s = Next(s)) {
+         if (s->IsActive() && !s->IsBlocked(deviceIdP) && s->CanAssign(deviceIdP, sourceP, systemP)) {
+            int score = s->Score(sourceP, systemP);
+            dbg_chan_switch("%s (%d, %d) %s score=%d", __PRETTY_FUNCTION__, deviceIdP, sourceP, s->Description(), score);
+            if (!best || (score < bestScore)) {
+               best = s;
+               bestScore = score;
+               }
+            }
+         }
+     if (best && best->Assign(deviceIdP, sourceP, systemP, transponderP)) {
+        best->StartProbe(deviceIdP);
+        return best;
+        }
+     }
   for (cSatipServer *s = First(); s; s = Next(s)) {
-      if (s->IsActive() && s->Assign(deviceIdP, sourceP, systemP, transponderP))
+      if (s->IsActive() && !s->IsBlocked(deviceIdP) && s->Assign(deviceIdP, sourceP, systemP, transponderP)) {
+         s->StartProbe(deviceIdP);
          return s;
+         }
       }
   return NULL;
 }
@@ -441,6 +807,72 @@ void cSatipServers::Detach(cSatipServer *serverP, int deviceIdP, int transponder
       }
 }
 
+void cSatipServers::AddZapTime(cSatipServer *serverP, uint64_t msP)
+{
+  for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         s->AddZapTime(msP);
+         break;
+         }
+      }
+}
+
+void cSatipServers::AddSavedRequest(cSatipServer *serverP)
+{
+  for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         s->AddSavedRequest();
+         break;
+         }
+      }
+}
+
+void cSatipServers::AddError(cSatipServer *serverP)
+{
+  for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         s->AddError();
+         break;
+         }
+      }
+}
+
+void cSatipServers::AddSuccess(cSatipServer *serverP)
+{
+  for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         s->AddSuccess();
+         break;
+         }
+      }
+}
+
+bool cSatipServers::IsBlocked(cSatipServer *serverP, int deviceIdP)
+{
+  // A server no longer listed has been removed, so fail over from it. Like all the lookups here
+  // this is keyed on the pointer only, which a server added later may reuse; its health is used then.
+  bool result = true;
+  for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         result = s->IsBlocked(deviceIdP);
+         break;
+         }
+      }
+  return result;
+}
+
+bool cSatipServers::Probe(cSatipServer *serverP, int deviceIdP)
+{
+  bool result = false;
+  for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         result = s->Probe(deviceIdP);
+         break;
+         }
+      }
+  return result;
+}
+
 bool cSatipServers::IsQuirk(cSatipServer *serverP, int quirkP)
 {
   bool result = false;
@@ -465,9 +897,24 @@ bool cSatipServers::HasCI(cSatipServer *serverP)
   return result;
 }
 
-void cSatipServers::Cleanup(uint64_t intervalMsP)
+int cSatipServers::GetPidLimit(cSatipServer *serverP)
 {
+  int result = SatipConfig.GetPidLimit();
   for (cSatipServer *s = First(); s; s = Next(s)) {
+      if (s == serverP) {
+         if (s->PidLimit() > 0)
+            result = s->PidLimit();
+         break;
+         }
+      }
+  return result;
+}
+
+void cSatipServers::Cleanup(uint64_t intervalMsP)
+{
+  cSatipServer *next;
+  for (cSatipServer *s = First(); s; s = next) {
+      next = Next(s);
       if (!intervalMsP || (s->LastSeen() > intervalMsP)) {
          info("Removing server %s (%s %s)", s->Description(), s->Address(), s->Model());
          Del(s);
@@ -475,6 +922,36 @@ void cSatipServers::Cleanup(uint64_t intervalMsP)
       }
 }
 
+int cSatipServers::CleanupUnverified(void)
+{
+  int count = 0;
+  cSatipServer *next;
+  for (cSatipServer *s = First(); s; s = next) {
+      next = Next(s);
+      if (!s->IsVerified()) {
+         info("Removing unverified server %s (%s %s)", s->Description(), s->Address(), s->Model());
+         Del(s);
+         ++count;
+         }
+      }
+  return count;
+}
+
+int cSatipServers::CleanupAddress(const char *addressP)
+{
+  int count = 0;
+  cSatipServer *next;
+  for (cSatipServer *s = First(); s; s = next) {
+      next = Next(s);
+      if (!strcmp(s->Address(), addressP)) {
+         info("Removing server %s (%s %s)", s->Description(), s->Address(), s->Model());
+         Del(s);
+         ++count;
+         }
+      }
+  return count;
+}
+
 cString cSatipServers::GetSrcAddress(cSatipServer *serverP)
 {
   cString address = "";
@@ -528,9 +1005,9 @@ cString cSatipServers::List(void)
   cString list = "";
   for (cSatipServer *s = First(); s; s = Next(s))
       if (isempty(s->SrcAddress()))
-         list = cString::sprintf("%s%c %s|%s|%s\n", *list, s->IsActive() ? '+' : '-', s->Address(), s->Model(), s->Description());
+         list = cString::sprintf("%s%c %s|%s|%s|zap %s|saved %u|health %s%s\n", *list, s->IsActive() ? '+' : '-', s->Address(), s->Model(), s->Description(), *s->GetZapStatistic(), s->SavedRequests(), *s->GetHealthString(), s->IsVerified() ? "" : "|unverified");
       else
-         list = cString::sprintf("%s%c %s@%s|%s|%s\n", *list, s->IsActive() ? '+' : '-', s->SrcAddress(), s->Address(), s->Model(), s->Description());
+         list = cString::sprintf("%s%c %s@%s|%s|%s|zap %s|saved %u|health %s%s\n", *list, s->IsActive() ? '+' : '-', s->SrcAddress(), s->Address(), s->Model(), s->Description(), *s->GetZapStatistic(), s->SavedRequests(), *s->GetHealthString(), s->IsVerified() ? "" : "|unverified");
   return list;
 }
 
@@ -553,3 +1030,101 @@ int cSatipServers::NumProvidedSystems(void)
       }
   return count;
 }
+
+// --- cSatipSourceIndex ------------------------------------------------------
+
+cSatipSourceIndex::cSatipSourceIndex()
+: sequenceM(0),
+  typesM(0),
+  sourceCountM(0),
+  disabledCountM(0)
+{
+  for (int i = 0; i < eMaxSources; ++i) {
+      sourcesM[i].store(0, std::memory_order_relaxed);
+      disabledM[i].store(0, std::memory_order_relaxed);
+      }
+}
+
+unsigned int cSatipSourceIndex::TypeBit(int sourceP)
+{
+  switch ((char)(sourceP >> 24)) {
+    case 'S': return 0x01;
+    case 'T': return 0x02;
+    case 'C': return 0x04;
+    case 'A': return 0x08;
+    default:;
+    }
+  return 0;
+}
+
+void cSatipSourceIndex::Build(cSatipServers &serversP)
+{
+  unsigned int types = 0;
+  int sources = 0, disabled = 0;
+  unsigned int sequence = sequenceM.load(std::memory_order_relaxed);
+
+  sequenceM.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (cSatipServer *s = serversP.First(); s; s = serversP.Next(s)) {
+      // A server without filters provides every position of its source types
+      if (!s->SourceFilter(0)) {
+         static const int typeTable[] = { cSource::stSat, cSource::stTerr, cSource::stCable, cSource::stAtsc };
+         for (unsigned int i = 0; i < ELEMENTS(typeTable); ++i) {
+             if (s->ProvidesType(typeTable[i]))
+                types |= TypeBit(typeTable[i]);
+             }
+         continue;
+         }
+      for (unsigned int i = 0; s->SourceFilter(i); ++i) {
+          int source = s->SourceFilter(i);
+          bool found = false;
+          for (int j = 0; !found && (j < sources); ++j)
+              found = (sourcesM[j].load(std::memory_order_relaxed) == source);
+          if (!found && (sources < eMaxSources) && s->ProvidesType(source))
+             sourcesM[sources++].store(source, std::memory_order_relaxed);
+          }
+      }
+  for (unsigned int i = 0; (i < SatipConfig.GetDisabledSourcesCount()) && (disabled < eMaxSources); ++i)
+      disabledM[disabled++].store(SatipConfig.GetDisabledSources(i), std::memory_order_relaxed);
+  // Source descriptions starting with '0' are disabled
+  for (cSource *s = Sources.First(); s && (disabled < eMaxSources); s = Sources.Next(s)) {
+      if (s->Description() && (*(s->Description()) == '0'))
+         disabledM[disabled++].store(s->Code(), std::memory_order_relaxed);
+      }
+  typesM.store(types, std::memory_order_relaxed);
+  sourceCountM.store(sources, std::memory_order_relaxed);
+  disabledCountM.store(disabled, std::memory_order_relaxed);
+  sequenceM.store(sequence + 2, std::memory_order_release);
+  dbg_chan_switch("%s types=0x%02X sources=%d disabled=%d", __PRETTY_FUNCTION__, types, sources, disabled);
+}
+
+bool cSatipSourceIndex::Lookup(int sourceP) const
+{
+  int count = disabledCountM.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; ++i) {
+      if (disabledM[i].load(std::memory_order_relaxed) == sourceP)
+         return false;
+      }
+  if (typesM.load(std::memory_order_relaxed) & TypeBit(sourceP))
+     return true;
+  count = sourceCountM.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; ++i) {
+      if (sourcesM[i].load(std::memory_order_relaxed) == sourceP)
+         return true;
+      }
+  return false;
+}
+
+bool cSatipSourceIndex::Provides(int sourceP) const
+{
+  bool result;
+  unsigned int sequence;
+  do {
+     sequence = sequenceM.load(std::memory_order_acquire);
+     if (sequence & 1)
+        continue;
+     result = Lookup(sourceP);
+     std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) || (sequence != sequenceM.load(std::memory_order_relaxed)));
+  return result;
+}
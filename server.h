@@ -8,36 +8,88 @@
 #ifndef __SATIP_SERVER_H
 #define __SATIP_SERVER_H
 
+#include <atomic>
+
 class cSatipServer;
 
 // --- cSatipFrontend ---------------------------------------------------------
 
-class cSatipFrontend : public cListObject {
+class cSatipFrontend {
 private:
+  enum {
+    eReservationTimeoutMs = 10000 // in milliseconds
+  };
   int indexM;
   int transponderM;
   int deviceIdM;
-  cString descriptionM;
+  int reservedIdM;
+  cTimeMs reservationM;
+  const char *descriptionM;
 
 public:
-  cSatipFrontend(const int indexP, const char *descriptionP);
-  virtual ~cSatipFrontend();
-  void Attach(int deviceIdP) { deviceIdM = deviceIdP; }
-  void Detach(int deviceIdP) { if (deviceIdP == deviceIdM) deviceIdM = -1; }
-  cString Description(void) { return descriptionM; }
+  cSatipFrontend();
+  void Set(int indexP, const char *descriptionP) { indexM = indexP; descriptionM = descriptionP; }
+  void Attach(int deviceIdP) { deviceIdM = deviceIdP; reservedIdM = -1; }
+  void Detach(int deviceIdP) { if (deviceIdP == deviceIdM) deviceIdM = -1; if (deviceIdP == reservedIdM) reservedIdM = -1; }
+  void Reserve(int deviceIdP) { reservedIdM = deviceIdP; reservationM.Set(eReservationTimeoutMs); }
+  const char *Description(void) { return descriptionM; }
   bool Attached(void) { return (deviceIdM >= 0); }
+  bool Reserved(int deviceIdP) { return ((reservedIdM >= 0) && (reservedIdM != deviceIdP) && !reservationM.TimedOut()); }
+  bool Busy(void) { return (Attached() || ((reservedIdM >= 0) && !reservationM.TimedOut())); }
   int Index(void) { return indexM; }
   int Transponder(void) { return transponderM; }
   int DeviceId(void) { return deviceIdM; }
+  int ReservedId(void) { return reservedIdM; }
   void SetTransponder(int transponderP) { transponderM = transponderP; }
 };
 
 // --- cSatipFrontends --------------------------------------------------------
 
-class cSatipFrontends : public cList<cSatipFrontend> {
+// All frontends of a server in a single table. Bitmaps tell the frontends of
+// each delivery system and the attached and reserved ones, the frontends of a
+// device and the ones tuned to a transponder are found via small indexes.
+class cSatipFrontends {
+private:
+  enum {
+    eMaxFrontends     = 64,  // bits of the bitmaps
+    eMaxSystems       = 8,
+    eTransponderSlots = 128  // power of two, twice the frontends
+  };
+  struct tSatipTransponderSlot {
+    bool used;
+    int transponder;
+    uint64_t frontends;
+  };
+  cSatipFrontend frontendsM[eMaxFrontends];
+  int countM;
+  uint64_t systemsM[eMaxSystems];
+  uint64_t attachedM;
+  uint64_t reservedM;
+  int attachedByM[SATIP_MAX_DEVICES];
+  int reservedByM[SATIP_MAX_DEVICES];
+  tSatipTransponderSlot transpondersM[eTransponderSlots];
+  int usedSlotsM;
+  static uint64_t Bit(int indexP) { return (1ULL << indexP); }
+  static bool IsDevice(int deviceIdP) { return ((deviceIdP >= 0) && (deviceIdP < SATIP_MAX_DEVICES)); }
+  int Slot(int transponderP, bool addP);
+  void RebuildSlots(void);
+  uint64_t Tuned(int transponderP);
+  uint64_t Mask(int systemP) { return ((systemP >= 0) && (systemP < eMaxSystems)) ? systemsM[systemP] : 0; }
+  void ExpireReservations(uint64_t maskP);
+  void SetTransponder(int indexP, int transponderP);
+  void AttachFrontend(int indexP, int deviceIdP);
+  void DetachFrontend(int indexP, int deviceIdP);
+  void ReserveFrontend(int indexP, int deviceIdP);
+  int Own(int systemP, int deviceIdP);
+
 public:
-  bool Matches(int deviceIdP, int transponderP);
-  bool Assign(int deviceIdP, int transponderP);
+  cSatipFrontends();
+  bool Add(int systemP, const char *descriptionP);
+  int Count(int systemP) { return __builtin_popcountll(Mask(systemP)); }
+  int Unused(int systemP, int deviceIdP);
+  int Busy(int systemP);
+  bool Matches(int systemP, int deviceIdP, int transponderP);
+  bool Assign(int systemP, int deviceIdP, int transponderP);
   bool Attach(int deviceIdP, int transponderP);
   bool Detach(int deviceIdP, int transponderP);
 };
@@ -58,21 +110,59 @@ private:
   enum {
     eSatipMaxSourceFilters = 16
   };
+  // Weights of the least loaded server selection, a lower score wins
+  enum {
+    eErrorWindowMs    = 60000, // in milliseconds
+    eScoreLoad        = 1000,  // all frontends of the delivery system in use
+    eScoreError       = 500,   // per error within the window
+    eScoreMaxZapTime  = 5000,  // in milliseconds, counted as ms / 10
+    eScoreAffinity    = 250    // the source is listed in the filters
+  };
+  // Circuit breaker: open after consecutive failures, half-open lets a single probe through
+  enum eHealth {
+    eHealthOk = 0,
+    eHealthOpen,
+    eHealthHalfOpen
+  };
+  enum {
+    eHealthMaxFailures    = 3,
+    eHealthMinBackoffMs   = 5000,   // in milliseconds
+    eHealthMaxBackoffMs   = 300000, // in milliseconds
+    eHealthProbeTimeoutMs = 15000   // in milliseconds
+  };
   cString srcAddressM;
   cString addressM;
   cString modelM;
   cString filtersM;
   cString descriptionM;
   cString quirksM;
-  cSatipFrontends frontendsM[delsysCount];
+  cSatipFrontends frontendsM;
   int sourceFiltersM[eSatipMaxSourceFilters];
   int portM;
   int quirkM;
+  int pidLimitM;
   bool hasCiM;
   bool activeM;
+  bool verifiedM;
+  unsigned int errorsM;
+  cTimeMs errorTimeM;
+  int healthM;
+  unsigned int failuresM;
+  unsigned int backoffMsM;
+  cTimeMs openedM;
+  bool probingM;
+  int probeDeviceM;
+  cTimeMs probeM;
+  void Open(void);
   time_t createdM;
   cTimeMs lastSeenM;
+  uint64_t zapTimeM;
+  uint64_t zapTimeSumM;
+  unsigned int zapCountM;
+  unsigned int savedRequestsM;
   bool IsValidSource(int sourceP);
+  void AddFrontends(int delsysP, const char *descriptionP, int countP);
+  int Systems(int sourceP, int delsysP, int *systemsP);
 
 public:
   enum eSatipQuirk {
@@ -85,14 +175,19 @@ public:
     eSatipQuirkCiTnr       = 0x20,
     eSatipQuirkForcePilot  = 0x40,
     eSatipQuirkTearAndPlay = 0x80,
-    eSatipQuirkMask        = 0xFF
+    eSatipQuirkFastZap     = 0x100,
+    eSatipQuirkMask        = 0x1FF
   };
-  cSatipServer(const char *srcAddressP, const char *addressP, const int portP, const char *modelP, const char *filtersP, const char *descriptionP, const int quirkP);
+  cSatipServer(const char *srcAddressP, const char *addressP, const int portP, const char *modelP, const char *filtersP, const char *descriptionP, const int quirkP, const int pidLimitP);
   virtual ~cSatipServer();
   virtual int Compare(const cListObject &listObjectP) const;
   bool Assign(int DeviceId, int Source, int DelSys, int Transponder);
   bool Matches(int Source);
+  bool ProvidesType(int Source);
+  int SourceFilter(unsigned int indexP) { return (indexP < ELEMENTS(sourceFiltersM)) ? sourceFiltersM[indexP] : 0; }
   bool Matches(int DeviceId, int Source, int DelSys, int Transponder);
+  bool CanAssign(int deviceIdP, int sourceP, int delsysP);
+  int Score(int sourceP, int delsysP);
   void Attach(int deviceIdP, int transponderP);
   void Detach(int deviceIdP, int transponderP);
   int GetModulesDVBS2(void);
@@ -102,6 +197,7 @@ public:
   int GetModulesDVBC2(void);
   int GetModulesATSC(void);
   void Activate(bool onOffP)    { activeM = onOffP; }
+  void Verify(bool onOffP)      { verifiedM = onOffP; }
   const char *SrcAddress(void)  { return *srcAddressM; }
   const char *Address(void)     { return *addressM; }
   const char *Model(void)       { return *modelM; }
@@ -109,13 +205,27 @@ public:
   const char *Description(void) { return *descriptionM; }
   const char *Quirks(void)      { return *quirksM; }
   int Port(void)                { return portM; }
+  int PidLimit(void)            { return pidLimitM; }
+  int QuirkMask(void)           { return quirkM; }
   bool Quirk(int quirkP)        { return ((quirkP & eSatipQuirkMask) & quirkM); }
   bool HasQuirk(void)           { return (quirkM != eSatipQuirkNone); }
   bool HasCI(void)              { return hasCiM; }
   bool IsActive(void)           { return activeM; }
-  void Update(void)             { lastSeenM.Set(); }
+  bool IsVerified(void)         { return verifiedM; }
+  void Update(void)             { lastSeenM.Set(); verifiedM = true; }
   uint64_t LastSeen(void)       { return lastSeenM.Elapsed(); }
   time_t Created(void)          { return createdM; }
+  void AddZapTime(uint64_t msP) { zapTimeM = msP; zapTimeSumM += msP; ++zapCountM; }
+  cString GetZapStatistic(void);
+  void AddSavedRequest(void)    { ++savedRequestsM; }
+  void AddError(void);
+  void AddSuccess(void);
+  unsigned int Errors(void)     { return errorTimeM.TimedOut() ? 0 : errorsM; }
+  bool IsBlocked(int deviceIdP = -1);
+  bool Probe(int deviceIdP);
+  void StartProbe(int deviceIdP) { if (healthM == eHealthHalfOpen) { probingM = true; probeDeviceM = deviceIdP; probeM.Set(eHealthProbeTimeoutMs); } }
+  cString GetHealthString(void);
+  unsigned int SavedRequests(void) { return savedRequestsM; }
 };
 
 // --- cSatipServers ----------------------------------------------------------
@@ -129,9 +239,18 @@ public:
   void Activate(cSatipServer *serverP, bool onOffP);
   void Attach(cSatipServer *serverP, int deviceIdP, int transponderP);
   void Detach(cSatipServer *serverP, int deviceIdP, int transponderP);
+  void AddZapTime(cSatipServer *serverP, uint64_t msP);
+  void AddSavedRequest(cSatipServer *serverP);
+  void AddError(cSatipServer *serverP);
+  void AddSuccess(cSatipServer *serverP);
+  bool IsBlocked(cSatipServer *serverP, int deviceIdP);
+  bool Probe(cSatipServer *serverP, int deviceIdP);
   bool IsQuirk(cSatipServer *serverP, int quirkP);
   bool HasCI(cSatipServer *serverP);
+  int GetPidLimit(cSatipServer *serverP);
   void Cleanup(uint64_t intervalMsP = 0);
+  int CleanupUnverified(void);
+  int CleanupAddress(const char *addressP);
   cString GetAddress(cSatipServer *serverP);
   cString GetSrcAddress(cSatipServer *serverP);
   cString GetString(cSatipServer *serverP);
@@ -140,4 +259,29 @@ public:
   int NumProvidedSystems(void);
 };
 
+// --- cSatipSourceIndex ------------------------------------------------------
+
+// The sources provided by the servers for lookups without any locking. The
+// index is rebuilt only when the servers or the disabled sources change and
+// the readers retry if they overlap with a rebuild.
+class cSatipSourceIndex {
+private:
+  enum {
+    eMaxSources = 128
+  };
+  std::atomic<unsigned int> sequenceM;
+  std::atomic<unsigned int> typesM;
+  std::atomic<int> sourceCountM;
+  std::atomic<int> disabledCountM;
+  std::atomic<int> sourcesM[eMaxSources];
+  std::atomic<int> disabledM[eMaxSources];
+  static unsigned int TypeBit(int sourceP);
+  bool Lookup(int sourceP) const;
+
+public:
+  cSatipSourceIndex();
+  void Build(cSatipServers &serversP);
+  bool Provides(int sourceP) const;
+};
+
 #endif // __SATIP_SERVER_H
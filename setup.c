@@ -92,6 +92,9 @@ private:
   cString modelM;
   cString descriptionM;
   cString ciExtensionM;
+  cString zapTimeM;
+  unsigned int savedRequestsM;
+  cString healthM;
   uint64_t createdM;
   void Setup(void);
 
@@ -109,6 +112,9 @@ cSatipServerInfo::cSatipServerInfo(cSatipServer *serverP)
   modelM(serverP ? serverP->Model() : "---"),
   descriptionM(serverP ? serverP->Description() : "---"),
   ciExtensionM(serverP && serverP->HasCI() ? trVDR("yes") : trVDR("no")),
+  zapTimeM(serverP ? serverP->GetZapStatistic() : "---"),
+  savedRequestsM(serverP ? serverP->SavedRequests() : 0),
+  healthM(serverP ? serverP->GetHealthString() : "---"),
   createdM(serverP ? serverP->Created() : 0)
 {
   SetMenuCategory(mcSetupPlugins);
@@ -127,6 +133,9 @@ void cSatipServerInfo::Setup(void)
   Add(new cOsdItem(cString::sprintf("%s:\t%s", tr("Model"),         *modelM),                osUnknown, false));
   Add(new cOsdItem(cString::sprintf("%s:\t%s", tr("Description"),   *descriptionM),          osUnknown, false));
   Add(new cOsdItem(cString::sprintf("%s:\t%s", tr("CI extension"),  *ciExtensionM),          osUnknown, false));
+  Add(new cOsdItem(cString::sprintf("%s:\t%s", tr("Zap time"),      *zapTimeM),              osUnknown, false));
+  Add(new cOsdItem(cString::sprintf("%s:\t%u", tr("Saved requests"), savedRequestsM),        osUnknown, false));
+  Add(new cOsdItem(cString::sprintf("%s:\t%s", tr("Health"),        *healthM),               osUnknown, false));
   Add(new cOsdItem(cString::sprintf("%s:\t%s", tr("Creation date"), *DayDateTime(createdM)), osUnknown, false));
 }
 
@@ -346,8 +355,14 @@ cSatipPluginSetup::cSatipPluginSetup()
   deviceCountM(0),
   operatingModeM(SatipConfig.GetOperatingMode()),
   transportModeM(SatipConfig.GetTransportMode()),
+  serverSelectionM(SatipConfig.GetServerSelection()),
   ciExtensionM(SatipConfig.GetCIExtension()),
   frontendReuseM(SatipConfig.GetFrontendReuse()),
+  preTuningM(SatipConfig.GetPreTuning()),
+  pidUpdateWindowM(SatipConfig.GetPidUpdateWindow()),
+  pidLimitM(SatipConfig.GetPidLimit()),
+  msearchCountM(SatipConfig.GetMsearchCount()),
+  msearchMxM(SatipConfig.GetMsearchMx()),
   eitScanM(SatipConfig.GetEITScan()),
   numDisabledSourcesM(SatipConfig.GetDisabledSourcesCount()),
   numDisabledFiltersM(SatipConfig.GetDisabledFiltersCount())
@@ -360,6 +375,8 @@ cSatipPluginSetup::cSatipPluginSetup()
   transportModeTextsM[cSatipConfig::eTransportModeUnicast]    = tr("Unicast");
   transportModeTextsM[cSatipConfig::eTransportModeMulticast]  = tr("Multicast");
   transportModeTextsM[cSatipConfig::eTransportModeRtpOverTcp] = tr("RTP-over-TCP");
+  serverSelectionTextsM[cSatipConfig::eServerSelectionFirst]       = tr("first");
+  serverSelectionTextsM[cSatipConfig::eServerSelectionLeastLoaded] = tr("least loaded");
   for (unsigned int i = 0; i < ELEMENTS(cicamsM); ++i)
       cicamsM[i] = SatipConfig.GetCICAM(i);
   for (unsigned int i = 0; i < ELEMENTS(ca_systems_table); ++i)
@@ -374,6 +391,18 @@ cSatipPluginSetup::cSatipPluginSetup()
       disabledFilterIndexesM[i] = SatipConfig.GetDisabledFilters(i);
       disabledFilterNamesM[i] = tr(section_filter_table[i].description);
       }
+  threadPolicyTextsM[cSatipConfig::eThreadPolicyOther] = tr("default");
+  threadPolicyTextsM[cSatipConfig::eThreadPolicyFifo]  = tr("SCHED_FIFO");
+  threadPolicyTextsM[cSatipConfig::eThreadPolicyRr]    = tr("SCHED_RR");
+  threadClassNamesM[SATIP_THREAD_POLLER]   = tr("Poller threads");
+  threadClassNamesM[SATIP_THREAD_TUNER]    = tr("Tuner threads");
+  threadClassNamesM[SATIP_THREAD_SECTION]  = tr("Section threads");
+  threadClassNamesM[SATIP_THREAD_DISCOVER] = tr("Discover threads");
+  for (unsigned int i = 0; i < SATIP_THREAD_CLASS_COUNT; ++i) {
+      strn0cpy(threadCpusM[i], SatipConfig.GetThreadCpus(i), sizeof(threadCpusM[i]));
+      threadPolicyM[i] = SatipConfig.GetThreadPolicy(i);
+      threadPriorityM[i] = SatipConfig.GetThreadPriority(i);
+      }
   SetMenuCategory(mcSetupPlugins);
   Setup();
   SetHelp(trVDR("Button$Scan"), NULL, tr("Button$Devices"), trVDR("Button$Info"));
@@ -423,6 +452,35 @@ void cSatipPluginSetup::Setup(void)
   Add(new cMenuEditBoolItem(tr("Enable frontend reuse"), &frontendReuseM));
   helpM.Append(tr("Define whether reusing a frontend for multiple channels in a transponder should be enabled."));
 
+  Add(new cMenuEditBoolItem(tr("Enable pre-tuning"), &preTuningM));
+  helpM.Append(tr("Define whether idle frontends shall be tuned to the transponders of the previous and next channel during live viewing.\n\nRecordings and other real tuning requests always take over these frontends."));
+
+  Add(new cMenuEditStraItem(tr("Server selection"), &serverSelectionM, ELEMENTS(serverSelectionTextsM), serverSelectionTextsM));
+  helpM.Append(tr("Define how a server is selected for a new transponder.\n\nfirst - the first server with a free frontend\nleast loaded - the server with the fewest frontends in use, recent errors and zap time"));
+
+  Add(new cMenuEditIntItem(tr("Pid update window [ms]"), &pidUpdateWindowM, 0, 1000));
+  helpM.Append(tr("Define the time window for collecting pid changes into a single request.\n\nThe first pid change after an idle period is always sent immediately."));
+
+  Add(new cMenuEditIntItem(tr("Pid limit"), &pidLimitM, 0, 8192, tr("none")));
+  helpM.Append(tr("Define the number of pids after which the whole transponder is requested via \"pids=all\".\n\nA server specific value can be given via the \"--server\" command-line parameter."));
+
+  Add(new cMenuEditIntItem(tr("M-SEARCH transmissions"), &msearchCountM, 1, 5));
+  helpM.Append(tr("Define how many times each M-SEARCH query of the server discovery is sent.\n\nThe queries are sent with one second interval."));
+
+  Add(new cMenuEditIntItem(tr("M-SEARCH MX [s]"), &msearchMxM, 1, 5));
+  helpM.Append(tr("Define the maximum time servers may delay their answers to an M-SEARCH query."));
+
+  for (unsigned int i = 0; i < SATIP_THREAD_CLASS_COUNT; ++i) {
+      Add(new cMenuEditStraItem(threadClassNamesM[i], &threadPolicyM[i], ELEMENTS(threadPolicyTextsM), threadPolicyTextsM));
+      helpM.Append(tr("Define the scheduling policy of the threads.\n\nRealtime policies require the CAP_SYS_NICE capability and take effect when the threads are restarted."));
+      Add(new cMenuEditStrItem(*cString::sprintf(" %s", tr("CPUs")), threadCpusM[i], sizeof(threadCpusM[i]), "0123456789,-"));
+      helpM.Append(tr("Define the CPUs the threads are allowed to run on, e.g. \"2-3\" or \"0,2\".\n\nAn empty value keeps the default affinity."));
+      if (threadPolicyM[i] != cSatipConfig::eThreadPolicyOther) {
+         Add(new cMenuEditIntItem(*cString::sprintf(" %s", tr("Priority")), &threadPriorityM[i], 1, 99));
+         helpM.Append(tr("Define the realtime priority of the threads."));
+         }
+      }
+
   Add(new cOsdItem(tr("Active SAT>IP servers:"), osUnknown, false));
   helpM.Append("");
 
@@ -487,6 +545,8 @@ eOSState cSatipPluginSetup::ProcessKey(eKeys keyP)
   int oldFrontendReuse = frontendReuseM;
   int oldNumDisabledSources = numDisabledSourcesM;
   int oldNumDisabledFilters = numDisabledFiltersM;
+  int oldThreadPolicies[SATIP_THREAD_CLASS_COUNT];
+  memcpy(oldThreadPolicies, threadPolicyM, sizeof(oldThreadPolicies));
   eOSState state = cMenuSetupPage::ProcessKey(keyP);
 
   // Ugly hack with hardcoded '+/-' characters :(
@@ -510,7 +570,7 @@ eOSState cSatipPluginSetup::ProcessKey(eKeys keyP)
   if ((keyP == kNone) && (cSatipDiscover::GetInstance()->GetServers()->Count() != deviceCountM))
      Setup();
 
-  if ((keyP != kNone) && ((numDisabledSourcesM != oldNumDisabledSources) || (numDisabledFiltersM != oldNumDisabledFilters) || (operatingModeM != oldOperatingMode) || (ciExtensionM != oldCiExtension) || ( oldFrontendReuse != frontendReuseM) || (detachedModeM != SatipConfig.GetDetachedMode()))) {
+  if ((keyP != kNone) && ((numDisabledSourcesM != oldNumDisabledSources) || (numDisabledFiltersM != oldNumDisabledFilters) || (operatingModeM != oldOperatingMode) || (ciExtensionM != oldCiExtension) || ( oldFrontendReuse != frontendReuseM) || (detachedModeM != SatipConfig.GetDetachedMode()) || memcmp(oldThreadPolicies, threadPolicyM, sizeof(oldThreadPolicies)))) {
      while ((numDisabledSourcesM < oldNumDisabledSources) && (oldNumDisabledSources > 0))
            disabledSourcesM[--oldNumDisabledSources] = cSource::stNone;
      while ((numDisabledFiltersM < oldNumDisabledFilters) && (oldNumDisabledFilters > 0))
@@ -569,6 +629,15 @@ void cSatipPluginSetup::StoreFilters(const char *nameP, int *valuesP)
   SetupStore(nameP, *buffer);
 }
 
+void cSatipPluginSetup::StoreThreads(const char *nameP)
+{
+  cString buffer = "";
+  for (unsigned int i = 0; i < SATIP_THREAD_CLASS_COUNT; ++i)
+      buffer = cString::sprintf("%s%s%s:%s:%s:%d", *buffer, i ? ";" : "", thread_class_table[i], threadCpusM[i], thread_policy_table[threadPolicyM[i]], threadPriorityM[i]);
+  dbg_parsing("%s (%s, %s)", __PRETTY_FUNCTION__, nameP, *buffer);
+  SetupStore(nameP, *buffer);
+}
+
 void cSatipPluginSetup::Store(void)
 {
   // Store values into setup.conf
@@ -576,19 +645,38 @@ void cSatipPluginSetup::Store(void)
   SetupStore("TransportMode", transportModeM);
   SetupStore("EnableCIExtension", ciExtensionM);
   SetupStore("EnableFrontendReuse", frontendReuseM);
+  SetupStore("EnablePreTuning", preTuningM);
+  SetupStore("ServerSelection", serverSelectionM);
+  SetupStore("PidUpdateWindow", pidUpdateWindowM);
+  SetupStore("PidLimit", pidLimitM);
+  SetupStore("MsearchCount", msearchCountM);
+  SetupStore("MsearchMx", msearchMxM);
   SetupStore("EnableEITScan", eitScanM);
   StoreCicams("CICAM", cicamsM);
   StoreSources("DisabledSources", disabledSourcesM);
   StoreFilters("DisabledFilters", disabledFilterIndexesM);
+  StoreThreads("Threads");
   // Update global config
   SatipConfig.SetOperatingMode(operatingModeM);
   SatipConfig.SetTransportMode(transportModeM);
   SatipConfig.SetCIExtension(ciExtensionM);
   SatipConfig.SetEITScan(eitScanM);
+  SatipConfig.SetPreTuning(preTuningM);
+  SatipConfig.SetServerSelection(serverSelectionM);
+  SatipConfig.SetPidUpdateWindow(pidUpdateWindowM);
+  SatipConfig.SetPidLimit(pidLimitM);
+  SatipConfig.SetMsearchCount(msearchCountM);
+  SatipConfig.SetMsearchMx(msearchMxM);
   for (int i = 0; i < MAX_CICAM_COUNT; ++i)
       SatipConfig.SetCICAM(i, cicamsM[i]);
   for (int i = 0; i < MAX_DISABLED_SOURCES_COUNT; ++i)
       SatipConfig.SetDisabledSources(i, disabledSourcesM[i]);
+  cSatipDiscover::GetInstance()->UpdateSourceIndex();
   for (int i = 0; i < SECTION_FILTER_TABLE_SIZE; ++i)
       SatipConfig.SetDisabledFilters(i, disabledFilterIndexesM[i]);
+  for (unsigned int i = 0; i < SATIP_THREAD_CLASS_COUNT; ++i) {
+      SatipConfig.SetThreadCpus(i, threadCpusM[i]);
+      SatipConfig.SetThreadPolicy(i, threadPolicyM[i]);
+      SatipConfig.SetThreadPriority(i, threadPriorityM[i]);
+      }
 }
@@ -21,8 +21,15 @@ private:
   int transportModeM;
   const char *operatingModeTextsM[cSatipConfig::eOperatingModeCount];
   const char *transportModeTextsM[cSatipConfig::eTransportModeCount];
+  int serverSelectionM;
+  const char *serverSelectionTextsM[cSatipConfig::eServerSelectionCount];
   int ciExtensionM;
   int frontendReuseM;
+  int preTuningM;
+  int pidUpdateWindowM;
+  int pidLimitM;
+  int msearchCountM;
+  int msearchMxM;
   int cicamsM[MAX_CICAM_COUNT];
   const char *cicamTextsM[CA_SYSTEMS_TABLE_SIZE];
   int eitScanM;
@@ -31,6 +38,11 @@ private:
   int numDisabledFiltersM;
   int disabledFilterIndexesM[SECTION_FILTER_TABLE_SIZE];
   const char *disabledFilterNamesM[SECTION_FILTER_TABLE_SIZE];
+  char threadCpusM[SATIP_THREAD_CLASS_COUNT][SATIP_THREAD_CPUS_LENGTH];
+  int threadPolicyM[SATIP_THREAD_CLASS_COUNT];
+  int threadPriorityM[SATIP_THREAD_CLASS_COUNT];
+  const char *threadPolicyTextsM[cSatipConfig::eThreadPolicyCount];
+  const char *threadClassNamesM[SATIP_THREAD_CLASS_COUNT];
   cVector<const char*> helpM;
 
   eOSState DeviceScan(void);
@@ -41,6 +53,7 @@ private:
   void StoreCicams(const char *nameP, int *cicamsP);
   void StoreSources(const char *nameP, int *sourcesP);
   void StoreFilters(const char *nameP, int *valuesP);
+  void StoreThreads(const char *nameP);
 
 protected:
   virtual eOSState ProcessKey(eKeys keyP);
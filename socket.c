@@ -117,7 +117,8 @@ bool cSatipSocket::Open(const int portP, const bool reuseP)
 bool cSatipSocket::OpenMulticast(const int portP, const char *streamAddrP, const char *sourceAddrP)
 {
   dbg_funcname("%s (%d, %s, %s)", __PRETTY_FUNCTION__, portP, streamAddrP, sourceAddrP);
-  if (Open(portP)) {
+  // Several groups might be received on the same port
+  if (Open(portP, true)) {
      CheckAddress(streamAddrP, &streamAddrM);
      if (!isempty(sourceAddrP))
         useSsmM = CheckAddress(sourceAddrP, &sourceAddrM);
@@ -189,6 +190,11 @@ bool cSatipSocket::Join(void)
   dbg_funcname("%s", __PRETTY_FUNCTION__);
   // Check if socket exists
   if (socketDescM >= 0 && !isMulticastM) {
+#ifdef IP_MULTICAST_ALL
+     // Receive only the groups joined via this socket
+     int no = 0;
+     ERROR_IF_RET(setsockopt(socketDescM, SOL_IP, IP_MULTICAST_ALL, &no, sizeof(no)) < 0, "setsockopt(IP_MULTICAST_ALL)", return false);
+#endif
      // Join a new multicast group
      if (useSsmM) {
         // Source-specific multicast (SSM) is used
@@ -252,7 +258,7 @@ bool cSatipSocket::Leave(void)
   return true;
 }
 
-int cSatipSocket::Read(unsigned char *bufferAddrP, unsigned int bufferLenP)
+int cSatipSocket::Read(unsigned char *bufferAddrP, unsigned int bufferLenP, in_addr_t *srcAddrP)
 {
   dbg_funcname_ext("%s (, %d)", __PRETTY_FUNCTION__, bufferLenP);
   // Error out if socket not initialized
@@ -283,6 +289,8 @@ int cSatipSocket::Read(unsigned char *bufferAddrP, unsigned int bufferLenP)
     if (socketDescM && bufferAddrP && (bufferLenP > 0))
        len = (int)recvmsg(socketDescM, &msgh, MSG_DONTWAIT);
     if (len > 0) {
+       if (srcAddrP)
+          *srcAddrP = sockAddrM.sin_addr.s_addr;
 #ifndef __FreeBSD__
        if (isMulticastM) {
           // Process auxiliary received data and validate source address
@@ -350,9 +358,9 @@ int cSatipSocket::ReadMulti(unsigned char *bufferAddrP, unsigned int *elementRec
 }
 
 
-bool cSatipSocket::Write(const char *addrP, const unsigned char *bufferAddrP, unsigned int bufferLenP)
+bool cSatipSocket::Write(const char *addrP, const unsigned char *bufferAddrP, unsigned int bufferLenP, const int portP)
 {
-  dbg_funcname("%s (%s, , %d)", __PRETTY_FUNCTION__, addrP, bufferLenP);
+  dbg_funcname("%s (%s, , %d, %d)", __PRETTY_FUNCTION__, addrP, bufferLenP, portP);
   // Error out if socket not initialized
   if (socketDescM <= 0) {
      error("%s Invalid socket", __PRETTY_FUNCTION__);
@@ -361,7 +369,7 @@ bool cSatipSocket::Write(const char *addrP, const unsigned char *bufferAddrP, un
   struct sockaddr_in sockAddr;
   memset(&sockAddr, 0, sizeof(sockAddr));
   sockAddr.sin_family = AF_INET;
-  sockAddr.sin_port = htons((uint16_t)(socketPortM & 0xFFFF));
+  sockAddr.sin_port = htons((uint16_t)((portP ? portP : socketPortM) & 0xFFFF));
   sockAddr.sin_addr.s_addr = inet_addr(addrP);
   ERROR_IF_RET(sendto(socketDescM, bufferAddrP, bufferLenP, 0, (struct sockaddr *)&sockAddr, sizeof(sockAddr)) < 0, "sendto()", return false);
   return true;
@@ -37,9 +37,9 @@ public:
   bool IsMulticast(void) { return isMulticastM; }
   bool IsOpen(void) { return (socketDescM >= 0); }
   bool Flush(void);
-  int Read(unsigned char *bufferAddrP, unsigned int bufferLenP);
+  int Read(unsigned char *bufferAddrP, unsigned int bufferLenP, in_addr_t *srcAddrP = NULL);
   int ReadMulti(unsigned char *bufferAddrP, unsigned int *elementRecvSizeP, unsigned int elementCountP, unsigned int elementBufferSizeP);
-  bool Write(const char *addrP, const unsigned char *bufferAddrP, unsigned int bufferLenP);
+  bool Write(const char *addrP, const unsigned char *bufferAddrP, unsigned int bufferLenP, const int portP = 0);
 };
 
 #endif // __SATIP_SOCKET_H
@@ -5,6 +5,7 @@
  *
  */
 
+#include <inttypes.h>
 #include <limits.h>
 
 #include "common.h"
@@ -132,13 +133,103 @@ void cSatipPidStatistics::AddPidStatistic(int pidP, long payloadP)
      }
 }
 
+// --- cSatipStatisticsHistory ------------------------------------------------
+
+// Counter history class
+//
+// The writers sample their cumulative counters at most once per
+// eSampleIntervalMs into a small ring. Readers take a seqlock-style copy of
+// the ring and compute the windowed rates from it, so they neither block the
+// data path nor reset anything another reader might be looking at.
+cSatipStatisticsHistory::cSatipStatisticsHistory()
+: sequenceM(0),
+  nextSampleM(0),
+  headM(0),
+  countM(0)
+{
+  memset(samplesM, 0, sizeof(samplesM));
+}
+
+bool cSatipStatisticsHistory::Update(uint64_t totalP, long peakP)
+{
+  uint64_t now = cTimeMs::Now();
+  uint64_t next = nextSampleM.load(std::memory_order_relaxed);
+  if (now < next)
+     return false;
+  // Only one writer gets to store the sample for this interval
+  if (!nextSampleM.compare_exchange_strong(next, now + eSampleIntervalMs, std::memory_order_relaxed))
+     return false;
+  sequenceM.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  samplesM[headM].time = now;
+  samplesM[headM].total = totalP;
+  samplesM[headM].peak = peakP;
+  headM = (headM + 1) % eHistorySize;
+  if (countM < eHistorySize)
+     countM++;
+  sequenceM.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+void cSatipStatisticsHistory::Snapshot(sampleStruct *samplesP, unsigned int &headP, unsigned int &countP) const
+{
+  unsigned int sequence;
+  do {
+     while ((sequence = sequenceM.load(std::memory_order_acquire)) & 1)
+           ;
+     memcpy(samplesP, samplesM, sizeof(samplesM));
+     headP = headM;
+     countP = countM;
+     std::atomic_thread_fence(std::memory_order_acquire);
+  } while (sequence != sequenceM.load(std::memory_order_relaxed));
+}
+
+long cSatipStatisticsHistory::GetRate(int windowMsP, const std::atomic<uint64_t> &totalP) const
+{
+  sampleStruct samples[eHistorySize];
+  unsigned int head, count;
+  Snapshot(samples, head, count);
+  // The counter and the clock must be read after the snapshot
+  uint64_t total = totalP.load(std::memory_order_relaxed);
+  uint64_t now = cTimeMs::Now();
+  if (!count)
+     return 0L;
+  // Use the newest sample that covers the whole window or the oldest one available
+  const sampleStruct *sample = NULL;
+  for (unsigned int i = 1; i <= count; ++i) {
+      sample = &samples[(head + eHistorySize - i) % eHistorySize];
+      if (sample->time + windowMsP <= now)
+         break;
+      }
+  uint64_t elapsed = now - sample->time; /* in milliseconds */
+  return elapsed ? (long)(1000.0L * (total - sample->total) / elapsed) : 0L;
+}
+
+long cSatipStatisticsHistory::GetPeak(int windowMsP, const std::atomic<long> &peakP) const
+{
+  sampleStruct samples[eHistorySize];
+  unsigned int head, count;
+  Snapshot(samples, head, count);
+  long peak = peakP.load(std::memory_order_relaxed);
+  uint64_t now = cTimeMs::Now();
+  for (unsigned int i = 1; i <= count; ++i) {
+      const sampleStruct *sample = &samples[(head + eHistorySize - i) % eHistorySize];
+      if (sample->time + windowMsP < now)
+         break;
+      if (sample->peak > peak)
+         peak = sample->peak;
+      }
+  return peak;
+}
+
 // --- cSatipTunerStatistics --------------------------------------------------
 
 // Tuner statistics class
 cSatipTunerStatistics::cSatipTunerStatistics()
 : dataBytesM(0),
-  timerM(),
-  mutexM()
+  failoverCountM(0),
+  failoverGapM(0),
+  historyM()
 {
   dbg_funcname("%s", __PRETTY_FUNCTION__);
 }
@@ -151,34 +242,41 @@ cSatipTunerStatistics::~cSatipTunerStatistics()
 cString cSatipTunerStatistics::GetTunerStatistic()
 {
   dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
-  mutexM.Lock();
-  uint64_t elapsed = timerM.Elapsed(); /* in milliseconds */
-  timerM.Set();
-  long bitrate = elapsed ? (long)(1000.0L * dataBytesM / KILOBYTE(1) / elapsed) : 0L;
-  dataBytesM = 0;
-  mutexM.Unlock();
+  long bitrate = historyM.GetRate(1000, dataBytesM) / KILOBYTE(1);
+  long bitrate10 = historyM.GetRate(10000, dataBytesM) / KILOBYTE(1);
+  long bitrate60 = historyM.GetRate(60000, dataBytesM) / KILOBYTE(1);
 
-  if (!SatipConfig.GetUseBytes())
+  if (!SatipConfig.GetUseBytes()) {
      bitrate *= 8;
-  cString s = cString::sprintf("%ld k%s/s", bitrate, SatipConfig.GetUseBytes() ? "B" : "bit");
+     bitrate10 *= 8;
+     bitrate60 *= 8;
+     }
+  cString s = cString::sprintf("%ld k%s/s (10s: %ld, 60s: %ld)", bitrate, SatipConfig.GetUseBytes() ? "B" : "bit", bitrate10, bitrate60);
+  if (failoverCountM)
+     s = cString::sprintf("%s failovers: %u (last gap %" PRIu64 " ms)", *s, (unsigned int)failoverCountM, (uint64_t)failoverGapM);
   return s;
 }
 
 void cSatipTunerStatistics::AddTunerStatistic(long bytesP)
 {
   dbg_funcname_ext("%s (%ld)", __PRETTY_FUNCTION__, bytesP);
-  cMutexLock MutexLock(&mutexM);
-  dataBytesM += bytesP;
+  uint64_t total = dataBytesM.fetch_add(bytesP, std::memory_order_relaxed) + bytesP;
+  historyM.Update(total);
+}
+
+void cSatipTunerStatistics::AddFailoverStatistic(uint64_t gapMsP)
+{
+  dbg_funcname("%s (%" PRIu64 ")", __PRETTY_FUNCTION__, gapMsP);
+  failoverGapM = gapMsP;
+  ++failoverCountM;
 }
 
 
 // Buffer statistics class
 cSatipBufferStatistics::cSatipBufferStatistics()
 : dataBytesM(0),
-  freeSpaceM(0),
   usedSpaceM(0),
-  timerM(),
-  mutexM()
+  historyM()
 {
   dbg_funcname("%s", __PRETTY_FUNCTION__);
 }
@@ -191,32 +289,36 @@ cSatipBufferStatistics::~cSatipBufferStatistics()
 cString cSatipBufferStatistics::GetBufferStatistic()
 {
   dbg_funcname_ext("%s", __PRETTY_FUNCTION__);
-  cMutexLock MutexLock(&mutexM);
-  uint64_t elapsed = timerM.Elapsed(); /* in milliseconds */
-  timerM.Set();
-  long bitrate = elapsed ? (long)(1000.0L * dataBytesM / KILOBYTE(1) / elapsed) : 0L;
+  long bitrate = historyM.GetRate(1000, dataBytesM) / KILOBYTE(1);
+  long bitrate10 = historyM.GetRate(10000, dataBytesM) / KILOBYTE(1);
+  long bitrate60 = historyM.GetRate(60000, dataBytesM) / KILOBYTE(1);
+  long usedSpace = historyM.GetPeak(10000, usedSpaceM);
   long totalSpace = SATIP_BUFFER_SIZE;
-  float percentage = (float)((float)usedSpaceM / (float)totalSpace * 100.0);
+  float percentage = (float)((float)usedSpace / (float)totalSpace * 100.0);
   long totalKilos = totalSpace / KILOBYTE(1);
-  long usedKilos = usedSpaceM / KILOBYTE(1);
+  long usedKilos = usedSpace / KILOBYTE(1);
   if (!SatipConfig.GetUseBytes()) {
      bitrate *= 8;
+     bitrate10 *= 8;
+     bitrate60 *= 8;
      totalKilos *= 8;
      usedKilos *= 8;
      }
-  cString s = cString::sprintf("Buffer bitrate: %ld k%s/s\nBuffer usage: %ld/%ld k%s (%2.1f%%)\n", bitrate,
-                               SatipConfig.GetUseBytes() ? "B" : "bit", usedKilos, totalKilos,
+  cString s = cString::sprintf("Buffer bitrate: %ld k%s/s (10s: %ld, 60s: %ld)\nBuffer usage: %ld/%ld k%s (%2.1f%%)\n", bitrate,
+                               SatipConfig.GetUseBytes() ? "B" : "bit", bitrate10, bitrate60, usedKilos, totalKilos,
                                SatipConfig.GetUseBytes() ? "B" : "bit", percentage);
-  dataBytesM = 0;
-  usedSpaceM = 0;
   return s;
 }
 
 void cSatipBufferStatistics::AddBufferStatistic(long bytesP, long usedP)
 {
   dbg_funcname_ext("%s (%ld, %ld)", __PRETTY_FUNCTION__, bytesP, usedP);
-  cMutexLock MutexLock(&mutexM);
-  dataBytesM += bytesP;
-  if (usedP > usedSpaceM)
-     usedSpaceM = usedP;
+  uint64_t total = dataBytesM.fetch_add(bytesP, std::memory_order_relaxed) + bytesP;
+  // Only the receiving thread writes here, so a plain maximum is sufficient
+  long used = usedSpaceM.load(std::memory_order_relaxed);
+  if (usedP > used)
+     usedSpaceM.store(used = usedP, std::memory_order_relaxed);
+  // Start a new peak interval once the current one has been sampled
+  if (historyM.Update(total, used))
+     usedSpaceM.store(0, std::memory_order_relaxed);
 }
@@ -8,6 +8,7 @@
 #ifndef __SATIP_STATISTICS_H
 #define __SATIP_STATISTICS_H
 
+#include <atomic>
 #include <vdr/thread.h>
 
 // Section statistics
@@ -50,6 +51,32 @@ private:
   static int SortPids(const void* data1P, const void* data2P);
 };
 
+// Counter history
+class cSatipStatisticsHistory {
+public:
+  enum {
+    eSampleIntervalMs = 1000, // in milliseconds
+    eHistorySize      = 61    // 60 seconds plus the current sample
+  };
+  cSatipStatisticsHistory();
+  bool Update(uint64_t totalP, long peakP = 0);
+  long GetRate(int windowMsP, const std::atomic<uint64_t> &totalP) const;
+  long GetPeak(int windowMsP, const std::atomic<long> &peakP) const;
+
+private:
+  struct sampleStruct {
+    uint64_t time;
+    uint64_t total;
+    long peak;
+  };
+  std::atomic<unsigned int> sequenceM;
+  std::atomic<uint64_t> nextSampleM;
+  sampleStruct samplesM[eHistorySize];
+  unsigned int headM;
+  unsigned int countM;
+  void Snapshot(sampleStruct *samplesP, unsigned int &headP, unsigned int &countP) const;
+};
+
 // Tuner statistics
 class cSatipTunerStatistics {
 public:
@@ -59,11 +86,13 @@ public:
 
 protected:
   void AddTunerStatistic(long bytesP);
+  void AddFailoverStatistic(uint64_t gapMsP);
 
 private:
-  long dataBytesM;
-  cTimeMs timerM;
-  cMutex mutexM;
+  std::atomic<uint64_t> dataBytesM;
+  std::atomic<unsigned int> failoverCountM;
+  std::atomic<uint64_t> failoverGapM;
+  cSatipStatisticsHistory historyM;
 };
 
 // Buffer statistics
@@ -77,11 +106,9 @@ protected:
   void AddBufferStatistic(long bytesP, long usedP);
 
 private:
-  long dataBytesM;
-  long freeSpaceM;
-  long usedSpaceM;
-  cTimeMs timerM;
-  cMutex mutexM;
+  std::atomic<uint64_t> dataBytesM;
+  std::atomic<long> usedSpaceM;
+  cSatipStatisticsHistory historyM;
 };
 
 #endif // __SATIP_STATISTICS_H
@@ -6,19 +6,27 @@
  */
 
 #include <cinttypes>
-#include <iostream>
-#include <sstream>
 
 #include "common.h"
 #include "config.h"
 #include "discover.h"
 #include "log.h"
+#include "multicast.h"
 #include "poller.h"
 #include "tuner.h"
 #include "param.h"
 #include "device.h"
 #include <vdr/channels.h>
-#include <repfunc.h>
+#include <vdr/remux.h>
+
+// Releases the tuner lock for the duration of a blocking RTSP request
+class cSatipTunerUnlock {
+private:
+  cMutex &mutexM;
+public:
+  explicit cSatipTunerUnlock(cMutex &mutexP) : mutexM(mutexP) { mutexM.Unlock(); }
+  ~cSatipTunerUnlock() { mutexM.Lock(); }
+};
 
 cSatipTuner::cSatipTuner(cSatipDevice& deviceP, unsigned int packetLenP)
 : cThread(cString::sprintf("SATIP#%d tuner", deviceP.GetId())),
@@ -34,14 +42,26 @@ cSatipTuner::cSatipTuner(cSatipDevice& deviceP, unsigned int packetLenP)
   lastParamM(""),
   tnrParamM(""),
   streamPortM(SATIP_DEFAULT_RTSP_PORT),
+  multicastM(false),
   currentServerM(NULL, deviceP.GetId(), 0),
   nextServerM(NULL, deviceP.GetId(), 0),
   mutexM(),
+  pidMutexM(),
+  sourceGenerationM(0),
   reConnectM(),
   keepAliveM(),
   statusUpdateM(),
-  pidUpdateCacheM(),
+  pidUpdateM(),
   setupTimeoutM(-1),
+  rtcpLockM(),
+  rtcpStatusM(),
+  zapStartM(0),
+  zapStateM(zsIdle),
+  zapTimeM(0),
+  failoverM(),
+  lastDataMsM(0),
+  gapStartMsM(0),
+  pidsPlayedM(false),
   sessionM(""),
   currentStateM(tsIdle),
   internalStateM(),
@@ -54,10 +74,18 @@ cSatipTuner::cSatipTuner(cSatipDevice& deviceP, unsigned int packetLenP)
   frontendIdM(-1),
   streamIdM(-1),
   pmtPidM(-1),
-  addPidsM(),
-  delPidsM(),
-  pidsM()
+  ownPidsM(),
+  pidsM(),
+  sentPidsM(),
+  shareCountM(0),
+  shareOwnerM(NULL),
+  allPidsM(false),
+  tpLengthM(0)
 {
+  memset(tpM, 0, sizeof(tpM));
+  for (int i = 0; i < SATIP_MAX_DEVICES; ++i)
+      sharesM[i].device = NULL;
+  memset(pidQueryM, 0, sizeof(pidQueryM));
   dbg_funcname("%s (, %d) [device %d]", __PRETTY_FUNCTION__, packetLenP, deviceIdM);
 
   // Open sockets
@@ -97,8 +125,12 @@ cSatipTuner::~cSatipTuner()
   externalStateM.Clear();
 
   // Close the listening sockets
-  cSatipPoller::GetInstance()->Unregister(rtcpM);
-  cSatipPoller::GetInstance()->Unregister(rtpM);
+  cSatipMulticast::GetInstance()->Unsubscribe(rtcpM);
+  cSatipMulticast::GetInstance()->Unsubscribe(rtpM);
+  if (!multicastM) {
+     cSatipPoller::GetInstance()->Unregister(rtcpM);
+     cSatipPoller::GetInstance()->Unregister(rtpM);
+     }
   rtcpM.Close();
   rtpM.Close();
 }
@@ -107,6 +139,7 @@ void cSatipTuner::Action(void)
 {
   dbg_funcname("%s Entering [device %d]", __PRETTY_FUNCTION__, deviceIdM);
 
+  SetThreadScheduling(SATIP_THREAD_TUNER);
   bool lastIdleStatus = false;
   cTimeMs idleCheck(eIdleCheckTimeoutMs);
   cTimeMs tuning(eTuningTimeoutMs);
@@ -114,6 +147,11 @@ void cSatipTuner::Action(void)
   // Do the thread loop
   while (Running()) {
         UpdateCurrentState();
+        if (zapStateM == zsDone) {
+           dbg_chan_switch("%s Zap to first packet took %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, (uint64_t)zapTimeM, deviceIdM);
+           currentServerM.AddZapTime(zapTimeM);
+           zapStateM = zsIdle;
+           }
         switch (currentStateM) {
           case tsIdle:
                dbg_tunerstate("%s: tsIdle [device %d]", __PRETTY_FUNCTION__, deviceIdM);
@@ -125,12 +163,19 @@ void cSatipTuner::Action(void)
                break;
           case tsSet:
                dbg_tunerstate("%s: tsSet [device %d]", __PRETTY_FUNCTION__, deviceIdM);
+               // Don't retry a failing server before its backoff has passed and let a single tuner probe it then,
+               // but look for another one
+               if (!ProbeServer()) {
+                  Failover();
+                  break;
+                  }
                if (currentServerM.IsQuirk(cSatipServer::eSatipQuirkTearAndPlay))
                   Disconnect();
                if (Connect()) {
                   tuning.Set(eTuningTimeoutMs);
                   RequestState(tsTuned, smInternal);
-                  UpdatePids(true);
+                  if (!pidsPlayedM)
+                     UpdatePids(true);
                   }
                else
                   Disconnect();
@@ -141,8 +186,8 @@ void cSatipTuner::Action(void)
                reConnectM.Set(eConnectTimeoutMs);
                idleCheck.Set(eIdleCheckTimeoutMs);
                lastIdleStatus = false;
-               // Read reception statistics via DESCRIBE and RTCP
-               if (hasLockM || ReadReceptionStatus()) {
+               // Read reception statistics via RTCP and fall back to DESCRIBE, but give RTCP a head start in fast-zap mode
+               if (hasLockM || ((!FastZap() || rtcpLockM.TimedOut()) && ReadReceptionStatus())) {
                   // Quirk for devices without valid reception data
                   if (currentServerM.IsQuirk(cSatipServer::eSatipQuirkForceLock)) {
                      hasLockM = true;
@@ -192,7 +237,7 @@ void cSatipTuner::Action(void)
                break;
           }
         if (!StateRequested())
-           sleepM.Wait(eSleepTimeoutMs); // to avoid busy loop and reduce cpu load
+           sleepM.Wait(SleepTimeout()); // to avoid busy loop and reduce cpu load
         }
   dbg_funcname("%s Exiting [device %d]", __PRETTY_FUNCTION__, deviceIdM);
 }
@@ -218,41 +263,123 @@ bool cSatipTuner::Close(void)
   return true;
 }
 
+bool cSatipTuner::IsReleased(void)
+{
+  cMutexLock MutexLock(&mutexM);
+  return ((currentStateM == tsIdle) && !internalStateM.Size() && !externalStateM.Size());
+}
+
+bool cSatipTuner::Release(void)
+{
+  cMutexLock MutexLock(&mutexM);
+  dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, deviceIdM);
+  streamAddrM = "";
+  streamParamM = "";
+  return RequestState(tsRelease, smExternal);
+}
+
+bool cSatipTuner::FastZap(void)
+{
+  cSatipTunerServer &server = nextServerM.IsValid() ? nextServerM : currentServerM;
+  // The CI extension parameters are sent only along with the forced pid update
+  return (server.IsQuirk(cSatipServer::eSatipQuirkFastZap) && !(SatipConfig.GetCIExtension() && server.HasCI()));
+}
+
 bool cSatipTuner::Connect(void)
 {
   cMutexLock MutexLock(&mutexM);
   dbg_funcname("%s [device %d]", __PRETTY_FUNCTION__, deviceIdM);
 
+  pidsPlayedM = false;
   if (!isempty(*streamAddrM)) {
      cString connectionUri = GetBaseUrl(*streamAddrM, streamPortM);
+     // The lock is released during the requests, so work on a snapshot of the source
+     cString param = streamParamM;
+     cSatipTunerServer server(NULL, deviceIdM, 0);
+     server = nextServerM;
+     unsigned int sourceGeneration = sourceGenerationM;
+     bool fastZap = FastZap();
+     cString pids = "";
+     cSatipPid playPids;
+     bool allPids = false;
+     if (fastZap) {
+        int limit = server.GetPidLimit();
+        cMutexLock PidLock(&pidMutexM);
+        // Fast-zap: put the pids into the initial request
+        allPids = (limit > 0) && (pidsM.Size() > limit);
+        if (allPids)
+           pids = "&pids=all";
+        else if (pidsM.Size()) {
+           pidsM.ListPids(pidQueryM, sizeof(pidQueryM));
+           pids = cString::sprintf("&pids=%s", pidQueryM);
+           }
+        playPids = pidsM;
+        }
      tnrParamM = "";
      // Just retune
      if (streamIdM >= 0) {
-        if (!strcmp(*streamParamM, *lastParamM) && hasLockM) {
+        if (!strcmp(*param, *lastParamM) && hasLockM) {
            dbg_funcname("%s Identical parameters [device %d]", __PRETTY_FUNCTION__, deviceIdM);
+           zapStateM = zsIdle;
            return true;
            }
-        cString uri = cString::sprintf("%sstream=%d?%s", *connectionUri, streamIdM, *streamParamM);
+        cString uri = cString::sprintf("%sstream=%d?%s%s", *connectionUri, streamIdM, *param, *pids);
         dbg_funcname("%s Retuning [device %d]", __PRETTY_FUNCTION__, deviceIdM);
-        if (rtspM.Play(*uri)) {
+        StartZapTimer();
+        bool played;
+        {
+        cSatipTunerUnlock Unlock(mutexM);
+        played = rtspM.Play(*uri);
+        }
+        if (played) {
+           if (server.IsValid())
+              server.AddSuccess();
+           else
+              currentServerM.AddSuccess();
            keepAliveM.Set(timeoutM);
-           lastParamM = streamParamM;
+           rtcpLockM.Set(eRtcpLockTimeoutMs);
+           rtcpStatusM.Set(0);
+           lastParamM = param;
+           if (!isempty(*pids)) {
+              cMutexLock PidLock(&pidMutexM);
+              pidsPlayedM = true;
+              sentPidsM = playPids;
+              allPidsM = allPids;
+              pidUpdateM.Set(0);
+              }
            return true;
            }
         }
-     else if (rtspM.SetInterface(nextServerM.IsValid() ? *nextServerM.GetSrcAddress() : NULL) && rtspM.Options(*connectionUri)) {
-        cString uri = cString::sprintf("%s?%s", *connectionUri, *streamParamM);
-        bool useTcp = SatipConfig.IsTransportModeRtpOverTcp() && nextServerM.IsValid() && nextServerM.IsQuirk(cSatipServer::eSatipQuirkRtpOverTcp);
+     else {
+        cString uri = cString::sprintf("%s?%s%s", *connectionUri, *param, *pids);
+        bool useTcp = SatipConfig.IsTransportModeRtpOverTcp() && server.IsValid() && server.IsQuirk(cSatipServer::eSatipQuirkRtpOverTcp);
         // Flush any old content
         //rtpM.Flush();
         //rtcpM.Flush();
         if (useTcp)
            dbg_funcname("%s Requesting TCP [device %d]", __PRETTY_FUNCTION__, deviceIdM);
-        if (rtspM.Setup(*uri, rtpM.Port(), rtcpM.Port(), useTcp)) {
+        bool connected = false;
+        if (rtspM.SetInterface(server.IsValid() ? *server.GetSrcAddress() : NULL)) {
+           cSatipTunerUnlock Unlock(mutexM);
+           // Fast-zap: skip the initial OPTIONS as SETUP will open the connection anyway
+           if (fastZap || rtspM.Options(*connectionUri)) {
+              StartZapTimer();
+              connected = rtspM.Setup(*uri, rtpM.Port(), rtcpM.Port(), useTcp);
+              }
+           }
+        if (connected) {
+           if (server.IsValid())
+              server.AddSuccess();
+           else
+              currentServerM.AddSuccess();
            keepAliveM.Set(timeoutM);
-           if (nextServerM.IsValid()) {
-              currentServerM = nextServerM;
-              nextServerM.Reset();
+           rtcpLockM.Set(eRtcpLockTimeoutMs);
+           rtcpStatusM.Set(0);
+           if (server.IsValid()) {
+              currentServerM = server;
+              // Keep any source change requested meanwhile for the next round
+              if (sourceGeneration == sourceGenerationM)
+                 nextServerM.Reset();
               }
            lastAddrM = connectionUri;
            currentServerM.Attach();
@@ -261,12 +388,51 @@ bool cSatipTuner::Connect(void)
         }
      rtspM.Reset();
      streamIdM = -1;
+     zapStateM = zsIdle;
+     // Let the server selection avoid this server for a while
+     if (server.IsValid())
+        server.AddError();
+     else
+        currentServerM.AddError();
      error("Connect failed [device %d]", deviceIdM);
      }
 
   return false;
 }
 
+void cSatipTuner::StartZapTimer(void)
+{
+  // The zap time counts from the tuning request, retunes of our own from the request sent
+  if (zapStateM != zsRequested)
+     zapStartM = cTimeMs::Now();
+  zapStateM = zsRunning;
+}
+
+bool cSatipTuner::IsServerBlocked(void)
+{
+  cMutexLock MutexLock(&mutexM);
+  return nextServerM.IsValid() ? nextServerM.IsBlocked() : currentServerM.IsBlocked();
+}
+
+bool cSatipTuner::ProbeServer(void)
+{
+  cMutexLock MutexLock(&mutexM);
+  return nextServerM.IsValid() ? nextServerM.Probe() : currentServerM.Probe();
+}
+
+void cSatipTuner::Failover(void)
+{
+  if (!failoverM.TimedOut())
+     return;
+  failoverM.Set(eFailoverIntervalMs);
+  uint64_t last = lastDataMsM;
+  if (deviceM.Failover()) {
+     // The gap is measured from the last packet of the failed server to the first one of the new server
+     gapStartMsM = last ? last : cTimeMs::Now();
+     info("Failing over to another server [device %d]", deviceIdM);
+     }
+}
+
 bool cSatipTuner::Disconnect(void)
 {
   cMutexLock MutexLock(&mutexM);
@@ -274,7 +440,10 @@ bool cSatipTuner::Disconnect(void)
 
   if (!isempty(*lastAddrM) && (streamIdM >= 0)) {
      cString uri = cString::sprintf("%sstream=%d", *lastAddrM, streamIdM);
+     {
+     cSatipTunerUnlock Unlock(mutexM);
      rtspM.Teardown(*uri);
+     }
      // some devices requires a teardown for TCP connection also
      rtspM.Reset();
      streamIdM = -1;
@@ -287,34 +456,83 @@ bool cSatipTuner::Disconnect(void)
   signalQualityM = -1;
   frontendIdM = -1;
 
+  // The groups are left once no other tuner receives them
+  if (multicastM) {
+     cSatipMulticast::GetInstance()->Unsubscribe(rtpM);
+     cSatipMulticast::GetInstance()->Unsubscribe(rtcpM);
+     }
   currentServerM.Detach();
   statusUpdateM.Set(0);
+  rtcpStatusM.Set(0);
   timeoutM = eMinKeepAliveIntervalMs - eKeepAlivePreBufferMs;
   pmtPidM = -1;
-  addPidsM.Clear();
-  delPidsM.Clear();
+  cMutexLock PidLock(&pidMutexM);
+  sentPidsM = pidsM;
+  allPidsM = false;
 
   // return always true
   return true;
 }
 
+void cSatipTuner::WritePids(cSatipDeviceIf &deviceP, const cSatipPid &pidsP, u_char *bufferP, int lengthP)
+{
+  // Consecutive packets of the wanted pids are written in a single call
+  u_char *run = NULL;
+  u_char *end = bufferP + lengthP / TS_SIZE * TS_SIZE;
+  for (u_char *p = bufferP; p < end; p += TS_SIZE) {
+      if (pidsP.HasPid(TsPid(p))) {
+         if (!run)
+            run = p;
+         }
+      else if (run) {
+         deviceP.WriteData(run, int(p - run));
+         run = NULL;
+         }
+      }
+  if (run)
+     deviceP.WriteData(run, int(end - run));
+}
+
 void cSatipTuner::ProcessVideoData(u_char *bufferP, int lengthP)
 {
   dbg_funcname_ext("%s (, %d) [device %d]", __PRETTY_FUNCTION__, lengthP, deviceIdM);
   if (lengthP > 0) {
      uint64_t elapsed;
+     uint64_t now = cTimeMs::Now();
      cTimeMs processing(0);
 
+     if (gapStartMsM) {
+        uint64_t start = gapStartMsM.exchange(0);
+        if (start && (now > start))
+           AddFailoverStatistic(now - start);
+        }
+     lastDataMsM = now;
+
      AddTunerStatistic(lengthP);
      elapsed = processing.Elapsed();
      if (elapsed > 1)
         dbg_rtp_perf("%s AddTunerStatistic() took %" PRIu64 " ms [device %d]", __PRETTY_FUNCTION__, elapsed, deviceIdM);
 
      processing.Set(0);
-     deviceM.WriteData(bufferP, lengthP);
+     if (shareCountM) {
+        // Each device gets only its own pids out of the shared session
+        cMutexLock PidLock(&pidMutexM);
+        WritePids(deviceM, ownPidsM, bufferP, lengthP);
+        for (int i = 0; i < SATIP_MAX_DEVICES; ++i) {
+            if (sharesM[i].device)
+               WritePids(*sharesM[i].device, sharesM[i].pids, bufferP, lengthP);
+            }
+        }
+     else
+        deviceM.WriteData(bufferP, lengthP);
      elapsed = processing.Elapsed();
      if (elapsed > 1)
         dbg_rtp_perf("%s WriteData() took %" PRIu64 " ms [device %d]", __FUNCTION__, elapsed, deviceIdM);
+
+     if (zapStateM == zsRunning) {
+        zapTimeM = now - zapStartM;
+        zapStateM = zsDone;
+        }
      }
   reConnectM.Set(eConnectTimeoutMs);
 }
@@ -327,162 +545,68 @@ void cSatipTuner::ProcessRtpData(u_char *bufferP, int lengthP)
 void cSatipTuner::ProcessApplicationData(u_char *bufferP, int lengthP)
 {
   dbg_funcname_ext("%s (%d) [device %d]", __PRETTY_FUNCTION__, lengthP, deviceIdM);
+  // RTCP APP packets carry the reception status, so DESCRIBE isn't needed while they keep coming
+  rtcpStatusM.Set(eRtcpStatusTimeoutMs);
+  ParseReceptionStatus(bufferP, lengthP);
+}
+
+void cSatipTuner::ProcessDescribeData(u_char *bufferP, int lengthP)
+{
+  dbg_funcname_ext("%s (%d) [device %d]", __PRETTY_FUNCTION__, lengthP, deviceIdM);
+  ParseReceptionStatus(bufferP, lengthP);
+}
+
+void cSatipTuner::ParseReceptionStatus(u_char *bufferP, int lengthP)
+{
   reConnectM.Set(eConnectTimeoutMs);
 
   if (lengthP < 33) /* bare minimum. */
      return;
 
-  char s[lengthP+1];
-  memcpy(s, (char *)bufferP, lengthP);
-  s[lengthP] = 0;
-
-  char* ps = strstr(s, "ver=");
-  auto payload = SplitStr(ps, ';');
-
-  if (payload.size() < 3)
+  tSatipReceptionStatus status;
+  if (!SatipParseReceptionStatus((const char *)bufferP, lengthP, &status))
      return;
 
-  // DVB-S2: ver=1.0;src=<srcID>;(..)
-  // DVB-T2: ver=1.1;(..)
-  // DVB-C2: ver=1.2;(..)
-
-  bool isSat   = payload[0] == "ver=1.0";
-  bool isTerr  = payload[0] == "ver=1.1";
-  bool isCable = payload[0] == "ver=1.2";
-  size_t next = 1;
-  int srcID = -1;
-
-  if (payload[next].find("src=") == 0)
-     srcID = StrToInt(payload[next++].substr(4));
-
-  // tuner=<feID>,<level>,<lock>,<quality>,(..)
-  auto params = SplitStr(payload[next++].substr(6), ',');
-  while(params.size() < 14)
-     params.push_back("");
-
-  dbg_rtcp("%s (%s) [device %d]", __PRETTY_FUNCTION__, ps, deviceIdM);
+  dbg_rtcp("%s (%.*s) [device %d]", __PRETTY_FUNCTION__, (int)status.transponderLength, status.transponder ? status.transponder : "", deviceIdM);
 
   // feID:
-  frontendIdM = StrToInt(params[0]);
+  frontendIdM = status.frontendId;
 
   // level: 0..255
   // 224 corresponds to -25dBm
   //  32 corresponds to -65dBm
   //   0 corresponds to 'no signal' (dBm not available)
-  int level = StrToInt(params[1]);
+  int level = status.level;
   signalStrengthDBmM = (level > 0) ? 40.0 * (level - 32) / 192.0 - 65.0 : 0.0;
   // Scale value to 0-100
   signalStrengthM = (level >= 0) ? 0.5 + level * 100.0 / 255.0 : -1;
 
   // lock: "0" = not locked, "1" = locked
-  hasLockM = params[2] == "1";
+  hasLockM = status.lock;
 
   // quality: 0..15, lowest value corresponds to highest error rate
   // The value 15 shall correspond to
   // -a BER lower than 2x10-4 after Viterbi for DVB-S
   // -a PER lower than 10-7 for DVB-S2
-  int quality = StrToInt(params[3]);
+  int quality = status.quality;
   // Scale value to 0-100
   signalQualityM = (hasLockM && (quality >= 0)) ? 0.5 + (quality * 100.0 / 15.0) : 0;
 
-  if (TP.size() == params.size()-4) {
-     bool equal = std::equal(params.begin()+4, params.end(), TP.begin());
-     if (equal)
-        return;
+  // The transponder parameters rarely change, so skip unchanged reports before any conversion
+  if (status.transponderLength == tpLengthM && (!tpLengthM || !memcmp(status.transponder, tpM, tpLengthM)))
+     return;
+  if (status.transponderLength < sizeof(tpM)) {
+     tpLengthM = status.transponderLength;
+     memcpy(tpM, status.transponder, tpLengthM);
      }
-  TP = {params.begin()+4, params.end()};
+  else
+     tpLengthM = 0;
 
   cChannel& channel = deviceM.currentChannel;
-  std::stringstream ss;
-
-  const bool DebugRtcp = false;
-
-  if (isSat) {
-     // <frequency>,<polarisation>,<system>,<type>,<pilots>,<roll_off>,<symbol_rate>,<fec_inner>
-     int  Frequency    = lround(StrToFloat(params[4]));                  // <frequency>,
-     char Polarisation = (UpperCase(params[5]))[0];                      // <polarisation>,
-     int  System       = SatipToVdrParameter("&msys=" + params[6]);      // <system>,
-     int  Type         = SatipToVdrParameter("&mtype=" + params[7]);     // <type>,
-     int  Pilots       = SatipToVdrParameter("&plts=" + params[8]);      // <pilots>,
-     int  RollOff      = SatipToVdrParameter("&ro=" + params[9]);        // <roll_off>,
-     int  SymbolRate   = params[10].empty()? 0 : StrToInt(params[10]);   // <symbol_rate>,
-     int  Fec          = SatipToVdrParameter("&fec=" + params[11]);      // <fec_inner>
-     int  Source       = SrcIdToSource(srcID);
-
-     if (Source < 0)
-        Source = channel.Source();
-     if (SymbolRate <= 0)
-        SymbolRate = channel.Srate();
-     ss << Polarisation;
-     ss << 'C' << Fec;
-     ss << 'M' << Type;
-     if (System > 0) {
-        ss << 'N' << Pilots;
-        ss << 'O' << RollOff;
-      //ss << 'P' << 999;
-        }
-     ss << 'S' << System;
-     if (DebugRtcp) {
-        std::cout << *(cSource::ToString(Source)) << ":"
-                  << Frequency << ":" << ss.str() << ":" << SymbolRate << std::endl;
-        }
-     channel.SetTransponderData(Source, Frequency, SymbolRate, ss.str().c_str(), true);
-     }
-  else if (isTerr) {
-     // <freq>,<bw>,<msys>,<tmode>,<mtype>,<gi>,<fec>,<plp>,<t2id>,<sm>
-     int  Frequency    = lround(StrToFloat(params[4]));                  // <freq>,
-     int  BandWidth    = SatipToVdrParameter("&bw=" + params[5]);        // <bw>,
-     int  System       = SatipToVdrParameter("&msys=" + params[6]);      // <msys>,
-     int  Transmission = SatipToVdrParameter("&tmode=" + params[7]);     // <tmode>,
-     int  Type         = SatipToVdrParameter("&mtype=" + params[8]);     // <mtype>,
-     int  Guard        = SatipToVdrParameter("&gi=" + params[9]);        // <gi>,
-     int  Fec          = SatipToVdrParameter("&fec=" + params[10]);      // <fec>,
-     int  Plp          = params[11].empty()? -1 : StrToInt(params[11]);  // <plp> (opt),
-     int  T2id         = params[12].empty()? -1 : StrToInt(params[12]);  // <t2id> (opt),
-     int  SM           = SatipToVdrParameter("&sm=" + params[next++]);   // <sm> (opt)
-
-     ss << 'B' << BandWidth;
-     ss << 'C' << Fec;
-     ss << 'G' << Guard;
-     ss << 'M' << Type;
-     if (System > 0) {
-        ss << 'P' << Plp;
-        ss << 'Q' << T2id;
-        }
-     ss << 'S' << System;
-     ss << 'T' << Transmission;
-     if (System > 0) {
-        ss << 'X' << SM;
-        }
-
-     if (DebugRtcp) {
-        std::cout << Frequency << ":" << ss.str() << std::endl;
-        }
-     channel.SetTransponderData('T' << 24, Frequency, 0, ss.str().c_str(), true);
-     }
-  else if (isCable) {
-     // <freq>,<bw>,<msys>,<mtype>,<sr>,<c2tft>,<ds>,<plp>,<specinv>
-     int  Frequency    = lround(StrToFloat(params[4]));                  // <freq>,
-   //int  BandWidth    = SatipToVdrParameter("&bw=" + params[5]);        // <bw> (opt),
-   //int  System       = SatipToVdrParameter("&msys=" + params[6]);      // <msys>,
-     int  Type         = SatipToVdrParameter("&mtype=" + params[7]);     // <mtype> (opt),
-     int  SymbolRate   = params[8].empty()? 0 : StrToInt(params[8]);     // <sr> (opt),
-   //int  C2tft        = params[9].empty()? 0 : StrToInt(params[9]);     // <c2tft> (opt),
-   //int  DS           = params[10].empty()? 0 : StrToInt(params[10]);   // <ds> (opt),
-   //int  Plp          = params[11].empty()? -1 : StrToInt(params[11]);  // <plp> (opt),
-     int  Inversion    = params[12].empty()? 999 : StrToInt(params[12]); // <specinv> (opt),
-
-     if (SymbolRate <= 0)
-        SymbolRate = channel.Srate();
-     ss << 'I' << Inversion;
-     ss << 'M' << Type;
-
-     // not used in VDR: BandWidth, System, C2tft, DS, Plp
-     if (DebugRtcp) {
-        std::cout << Frequency << ":" << ss.str() << ":" << SymbolRate << std::endl;
-        }
-     channel.SetTransponderData('C' << 24, Frequency, SymbolRate, ss.str().c_str(), true);
-     }
+  int source, frequency, symbolRate;
+  char parameters[64];
+  if (SatipToVdrTransponder(&status, &channel, &source, &frequency, &symbolRate, parameters, sizeof(parameters)))
+     channel.SetTransponderData(source, frequency, symbolRate, parameters, true);
 }
 
 void cSatipTuner::ProcessRtcpData(u_char *bufferP, int lengthP)
@@ -513,27 +637,41 @@ void cSatipTuner::SetupTransport(int rtpPortP, int rtcpPortP, const char *stream
   cMutexLock MutexLock(&mutexM);
   dbg_funcname("%s (%d, %d, %s, %s) [device %d]", __PRETTY_FUNCTION__, rtpPortP, rtcpPortP, streamAddrP, sourceAddrP, deviceIdM);
   bool multicast = !isempty(streamAddrP);
+  if (multicast) {
+     // Multicast groups are received via shared sockets, our own ones just keep their ports
+     if (!multicastM) {
+        cSatipPoller::GetInstance()->Unregister(rtpM);
+        cSatipPoller::GetInstance()->Unregister(rtcpM);
+        multicastM = true;
+        }
+     if (rtpPortP >= 0)
+        cSatipMulticast::GetInstance()->Subscribe(rtpM, rtpPortP, streamAddrP, sourceAddrP);
+     if (rtcpPortP >= 0)
+        cSatipMulticast::GetInstance()->Subscribe(rtcpM, rtcpPortP, streamAddrP, sourceAddrP);
+     return;
+     }
+  if (multicastM) {
+     cSatipMulticast::GetInstance()->Unsubscribe(rtpM);
+     cSatipMulticast::GetInstance()->Unsubscribe(rtcpM);
+     cSatipPoller::GetInstance()->Register(rtpM);
+     cSatipPoller::GetInstance()->Register(rtcpM);
+     multicastM = false;
+     }
   // Adapt RTP to any transport media change
-  if (multicast != rtpM.IsMulticast() || rtpPortP != rtpM.Port()) {
+  if (rtpPortP != rtpM.Port()) {
      cSatipPoller::GetInstance()->Unregister(rtpM);
      if (rtpPortP >= 0) {
         rtpM.Close();
-        if (multicast)
-           rtpM.OpenMulticast(rtpPortP, streamAddrP, sourceAddrP);
-        else
-           rtpM.Open(rtpPortP);
+        rtpM.Open(rtpPortP);
         cSatipPoller::GetInstance()->Register(rtpM);
         }
      }
   // Adapt RTCP to any transport media change
-  if (multicast != rtcpM.IsMulticast() || rtcpPortP != rtcpM.Port()) {
+  if (rtcpPortP != rtcpM.Port()) {
      cSatipPoller::GetInstance()->Unregister(rtcpM);
      if (rtcpPortP >= 0) {
         rtcpM.Close();
-        if (multicast)
-           rtcpM.OpenMulticast(rtcpPortP, streamAddrP, sourceAddrP);
-        else
-           rtcpM.Open(rtcpPortP);
+        rtcpM.Open(rtcpPortP);
         cSatipPoller::GetInstance()->Register(rtcpM);
         }
      }
@@ -559,6 +697,7 @@ bool cSatipTuner::SetSource(cSatipServer *serverP, const int transponderP, const
 {
   dbg_funcname("%s (%d, %s, %d) [device %d]", __PRETTY_FUNCTION__, transponderP, parameterP, indexP, deviceIdM);
   cMutexLock MutexLock(&mutexM);
+  ++sourceGenerationM;
   if (serverP) {
      nextServerM.Set(serverP, transponderP);
      if (!isempty(*nextServerM.GetAddress()) && !isempty(parameterP)) {
@@ -577,6 +716,8 @@ bool cSatipTuner::SetSource(cSatipServer *serverP, const int transponderP, const
            }
         RequestState(tsSet, smExternal);
         setupTimeoutM.Set(eSetupTimeoutMs);
+        zapStartM = cTimeMs::Now();
+        zapStateM = zsRequested;
         }
      }
   else {
@@ -590,51 +731,181 @@ bool cSatipTuner::SetSource(cSatipServer *serverP, const int transponderP, const
 bool cSatipTuner::SetPid(int pidP, int typeP, bool onP)
 {
   dbg_funcname_ext("%s (%d, %d, %d) [device %d]", __PRETTY_FUNCTION__, pidP, typeP, onP, deviceIdM);
-  cMutexLock MutexLock(&mutexM);
-  if (onP) {
-     pidsM.AddPid(pidP);
-     addPidsM.AddPid(pidP);
-     delPidsM.RemovePid(pidP);
+  // Only the pid lock is taken here, so pid changes never wait for RTSP requests
+  cMutexLock MutexLock(&pidMutexM);
+  if (onP)
+     ownPidsM.AddPid(pidP);
+  else
+     ownPidsM.RemovePid(pidP);
+  UpdatePidUnion();
+  dbg_pids("%s (%d, %d, %d) pids=%s [device %d]", __PRETTY_FUNCTION__, pidP, typeP, onP, *pidsM.ListPids(), deviceIdM);
+  // Forwarded under the pid lock, so the owner never misses a change while the share is set up or left
+  if (shareOwnerM)
+     shareOwnerM->SetSharePid(&deviceM, pidP, onP);
+  sleepM.Signal();
+
+  return true;
+}
+
+bool cSatipTuner::JoinShare(cSatipTuner *ownerP)
+{
+  cMutexLock MutexLock(&pidMutexM);
+  if (!ownerP || (ownerP == this) || shareCountM || !ownerP->AddShare(&deviceM, ownPidsM))
+     return false;
+  shareOwnerM = ownerP;
+  return true;
+}
+
+void cSatipTuner::LeaveShare(void)
+{
+  cMutexLock MutexLock(&pidMutexM);
+  if (shareOwnerM) {
+     shareOwnerM->RemoveShare(&deviceM);
+     shareOwnerM = NULL;
      }
-  else {
-     pidsM.RemovePid(pidP);
-     delPidsM.AddPid(pidP);
-     addPidsM.RemovePid(pidP);
+}
+
+void cSatipTuner::UpdatePidUnion(void)
+{
+  // The session carries the pids of this device and all of its sharers
+  pidsM = ownPidsM;
+  if (shareCountM) {
+     for (int i = 0; i < SATIP_MAX_DEVICES; ++i) {
+         if (sharesM[i].device)
+            pidsM.Merge(sharesM[i].pids);
+         }
      }
-  dbg_pids("%s (%d, %d, %d) pids=%s [device %d]", __PRETTY_FUNCTION__, pidP, typeP, onP, *pidsM.ListPids(), deviceIdM);
+}
+
+bool cSatipTuner::AddShare(cSatipDeviceIf *deviceP, const cSatipPid &pidsP)
+{
+  dbg_funcname("%s (%d) [device %d]", __PRETTY_FUNCTION__, deviceP ? deviceP->GetId() : -1, deviceIdM);
+  cMutexLock MutexLock(&pidMutexM);
+  int slot = -1;
+  for (int i = 0; i < SATIP_MAX_DEVICES; ++i) {
+      if (sharesM[i].device == deviceP)
+         return true;
+      if (!sharesM[i].device && (slot < 0))
+         slot = i;
+      }
+  if (!deviceP || (slot < 0))
+     return false;
+  sharesM[slot].device = deviceP;
+  sharesM[slot].pids = pidsP;
+  ++shareCountM;
+  UpdatePidUnion();
   sleepM.Signal();
 
   return true;
 }
 
+void cSatipTuner::RemoveShare(cSatipDeviceIf *deviceP)
+{
+  dbg_funcname("%s (%d) [device %d]", __PRETTY_FUNCTION__, deviceP ? deviceP->GetId() : -1, deviceIdM);
+  cMutexLock MutexLock(&pidMutexM);
+  for (int i = 0; i < SATIP_MAX_DEVICES; ++i) {
+      if (deviceP && (sharesM[i].device == deviceP)) {
+         sharesM[i].device = NULL;
+         sharesM[i].pids.Clear();
+         --shareCountM;
+         UpdatePidUnion();
+         sleepM.Signal();
+         break;
+         }
+      }
+}
+
+bool cSatipTuner::SetSharePid(cSatipDeviceIf *deviceP, int pidP, bool onP)
+{
+  dbg_funcname_ext("%s (%d, %d, %d) [device %d]", __PRETTY_FUNCTION__, deviceP ? deviceP->GetId() : -1, pidP, onP, deviceIdM);
+  cMutexLock MutexLock(&pidMutexM);
+  for (int i = 0; i < SATIP_MAX_DEVICES; ++i) {
+      if (deviceP && (sharesM[i].device == deviceP)) {
+         if (onP)
+            sharesM[i].pids.AddPid(pidP);
+         else
+            sharesM[i].pids.RemovePid(pidP);
+         UpdatePidUnion();
+         dbg_pids("%s (%d, %d, %d) pids=%s [device %d]", __PRETTY_FUNCTION__, deviceP->GetId(), pidP, onP, *pidsM.ListPids(), deviceIdM);
+         sleepM.Signal();
+         return true;
+         }
+      }
+
+  return false;
+}
+
+bool cSatipTuner::PidsPending(int limitP)
+{
+  // Once the whole transponder is requested, only crossing the limit again matters
+  if ((limitP > 0) && (pidsM.Size() > limitP))
+     return !allPidsM;
+  return (allPidsM || (pidsM != sentPidsM));
+}
+
+int cSatipTuner::SleepTimeout(void)
+{
+  // Wake up when the window of pending pid changes closes
+  if (currentStateM == tsLocked) {
+     int limit = currentServerM.GetPidLimit();
+     cMutexLock PidLock(&pidMutexM);
+     if (PidsPending(limit)) {
+        int remaining = (int)SatipConfig.GetPidUpdateWindow() - (int)pidUpdateM.Elapsed();
+        return constrain(remaining, 1, (int)eSleepTimeoutMs);
+        }
+     }
+  return eSleepTimeoutMs;
+}
+
 bool cSatipTuner::UpdatePids(bool forceP)
 {
   dbg_funcname_ext("%s (%d) tunerState=%s [device %d]", __PRETTY_FUNCTION__, forceP, TunerStateString(currentStateM), deviceIdM);
   cMutexLock MutexLock(&mutexM);
-  if (((forceP && pidsM.Size()) || (pidUpdateCacheM.TimedOut() && (addPidsM.Size() || delPidsM.Size()))) &&
+  int limit = currentServerM.GetPidLimit();
+  pidMutexM.Lock();
+  // The first change after an idle period is sent at once and any following ones are collected within the update window
+  if (((forceP && pidsM.Size()) || (PidsPending(limit) && (pidUpdateM.Elapsed() >= SatipConfig.GetPidUpdateWindow()))) &&
       !isempty(*streamAddrM) && (streamIdM >= 0)) {
-     cString uri = cString::sprintf("%sstream=%d", *GetBaseUrl(*streamAddrM, streamPortM), streamIdM);
+     // The added and deleted pids are the differences to the last played ones
+     cSatipPid playPids = pidsM;
+     bool allPids = (limit > 0) && (playPids.Size() > limit);
+     char *query = pidQueryM;
+     int size = sizeof(pidQueryM) - 1;
+     int length = 0;
      bool useci = (SatipConfig.GetCIExtension() && currentServerM.HasCI());
      bool usedummy = currentServerM.IsQuirk(cSatipServer::eSatipQuirkPlayPids);
-     bool paramadded = false;
-     if (forceP || usedummy) {
-        if (pidsM.Size()) {
-           uri = cString::sprintf("%s%spids=%s", *uri, paramadded ? "&" : "?", *pidsM.ListPids());
-           if (usedummy && (pidsM.Size() == 1) && (pidsM[0] < 0x20))
-              uri = cString::sprintf("%s,%d", *uri, eDummyPid);
-           paramadded = true;
-           }
+     *query = 0;
+     if (allPids) {
+        if (!allPidsM)
+           dbg_pids("%s Requesting all pids for %d pids [device %d]", __PRETTY_FUNCTION__, playPids.Size(), deviceIdM);
+        length += snprintf(query + length, size - length, "%spids=all", length ? "&" : "?");
         }
-     else {
-        if (addPidsM.Size()) {
-           uri = cString::sprintf("%s%saddpids=%s", *uri, paramadded ? "&" : "?", *addPidsM.ListPids());
-           paramadded = true;
+     else if (forceP || usedummy || allPidsM) {
+        if (playPids.Size()) {
+           length += snprintf(query + length, size - length, "%spids=", length ? "&" : "?");
+           length += playPids.ListPids(query + length, size - length);
+           if (usedummy && (playPids.Size() == 1) && (playPids.First() < 0x20))
+              length += snprintf(query + length, size - length, ",%d", eDummyPid);
            }
-        if (delPidsM.Size()) {
-           uri = cString::sprintf("%s%sdelpids=%s", *uri, paramadded ? "&" : "?", *delPidsM.ListPids());
-           paramadded = true;
+        else {
+           // Without any pids the server would keep streaming the whole transponder after pids=all
+           length += snprintf(query + length, size - length, "%spids=none", length ? "&" : "?");
            }
         }
+     else {
+        int n = snprintf(query + length, size - length, "%saddpids=", length ? "&" : "?");
+        int m = playPids.ListPids(query + length + n, size - length - n, &sentPidsM);
+        if (m > 0)
+           length += n + m;
+        query[length] = 0;
+        n = snprintf(query + length, size - length, "%sdelpids=", length ? "&" : "?");
+        m = sentPidsM.ListPids(query + length + n, size - length - n, &playPids);
+        if (m > 0)
+           length += n + m;
+        query[length] = 0;
+        }
+     cString uri = cString::sprintf("%sstream=%d%s", *GetBaseUrl(*streamAddrM, streamPortM), streamIdM, query);
+     bool paramadded = (length > 0);
      if (useci) {
         if (currentServerM.IsQuirk(cSatipServer::eSatipQuirkCiXpmt)) {
            // CI extension parameters:
@@ -664,12 +935,22 @@ bool cSatipTuner::UpdatePids(bool forceP)
            tnrParamM = param;
            }
         }
-     pidUpdateCacheM.Set(ePidUpdateIntervalMs);
-     if (!rtspM.Play(*uri))
+     pidMutexM.Unlock();
+     pidUpdateM.Set(0);
+     bool played;
+     {
+     cSatipTunerUnlock Unlock(mutexM);
+     played = rtspM.Play(*uri);
+     }
+     if (!played)
         return false;
-     addPidsM.Clear();
-     delPidsM.Clear();
+     // Any pid changes done during the request are kept for the next update
+     cMutexLock PidLock(&pidMutexM);
+     sentPidsM = playPids;
+     allPidsM = allPids;
+     return true;
      }
+  pidMutexM.Unlock();
 
   return true;
 }
@@ -680,6 +961,7 @@ bool cSatipTuner::Receive(void)
   cMutexLock MutexLock(&mutexM);
   if (!isempty(*streamAddrM)) {
      cString uri = GetBaseUrl(*streamAddrM, streamPortM);
+     cSatipTunerUnlock Unlock(mutexM);
      if (!rtspM.Receive(*uri))
         return false;
      }
@@ -697,6 +979,7 @@ bool cSatipTuner::KeepAlive(bool forceP)
      }
   if (forceP && !isempty(*streamAddrM)) {
      cString uri = GetBaseUrl(*streamAddrM, streamPortM);
+     cSatipTunerUnlock Unlock(mutexM);
      if (!rtspM.Options(*uri))
         return false;
      }
@@ -713,7 +996,13 @@ bool cSatipTuner::ReadReceptionStatus(bool forceP)
      forceP = true;
      }
   if (forceP && !isempty(*streamAddrM) && (streamIdM >= 0)) {
+     // Fresh RTCP reports make the DESCRIBE round trip unnecessary
+     if (!rtcpStatusM.TimedOut()) {
+        currentServerM.AddSavedRequest();
+        return true;
+        }
      cString uri = cString::sprintf("%sstream=%d", *GetBaseUrl(*streamAddrM, streamPortM), streamIdM);
+     cSatipTunerUnlock Unlock(mutexM);
      if (rtspM.Describe(*uri))
         return true;
      }
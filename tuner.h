@@ -8,11 +8,11 @@
 #ifndef __SATIP_TUNER_H
 #define __SATIP_TUNER_H
 
-#include <string>
-#include <vector>
+#include <atomic>
 #include <vdr/thread.h>
 #include <vdr/tools.h>
 
+#include "deviceif.h"
 #include "discover.h"
 #include "rtp.h"
 #include "rtcp.h"
@@ -25,33 +25,84 @@ class cSatipDevice;
 
 
 
-class cSatipPid : public cVector<int> {
+// A set of all possible pids as a bitmap: adding, removing and comparing never need sorting
+class cSatipPid {
+public:
+  enum {
+    eMaxPids       = SATIP_MAX_PIDS,
+    eMaxListLength = SATIP_MAX_PID_LIST_LENGTH
+  };
+
 private:
-  static int PidCompare(const void *aPidP, const void *bPidP)
-  {
-    return (*(int*)aPidP - *(int*)bPidP);
-  }
+  enum { eWordBits = 64, eWords = eMaxPids / eWordBits };
+  uint64_t bitsM[eWords];
+  int sizeM;
 
 public:
-  void RemovePid(const int &pidP)
-  {
-    if (RemoveElement(pidP))
-       Sort(PidCompare);
-  }
+  cSatipPid() { Clear(); }
+  void Clear(void) { memset(bitsM, 0, sizeof(bitsM)); sizeM = 0; }
+  int Size(void) const { return sizeM; }
+  bool HasPid(int pidP) const { return (pidP >= 0) && (pidP < eMaxPids) && (bitsM[pidP / eWordBits] & (1ULL << (pidP % eWordBits))); }
   void AddPid(int pidP)
   {
-    if (AppendUnique(pidP))
-       Sort(PidCompare);
+    if ((pidP >= 0) && (pidP < eMaxPids) && !HasPid(pidP)) {
+       bitsM[pidP / eWordBits] |= (1ULL << (pidP % eWordBits));
+       ++sizeM;
+       }
   }
-  cString ListPids(void)
+  void RemovePid(int pidP)
   {
-    cString list = "";
-    if (Size()) {
-       for (int i = 0; i < Size(); ++i)
-           list = cString::sprintf("%s%d,", *list, At(i));
-       list = list.Truncate(-1);
+    if (HasPid(pidP)) {
+       bitsM[pidP / eWordBits] &= ~(1ULL << (pidP % eWordBits));
+       --sizeM;
        }
-    return list;
+  }
+  int First(void) const
+  {
+    for (int i = 0; i < eWords; ++i) {
+        if (bitsM[i])
+           return i * eWordBits + __builtin_ctzll(bitsM[i]);
+        }
+    return -1;
+  }
+  void Merge(const cSatipPid &objP)
+  {
+    sizeM = 0;
+    for (int i = 0; i < eWords; ++i) {
+        bitsM[i] |= objP.bitsM[i];
+        sizeM += __builtin_popcountll(bitsM[i]);
+        }
+  }
+  bool operator== (const cSatipPid &objP) const { return (sizeM == objP.sizeM) && !memcmp(bitsM, objP.bitsM, sizeof(bitsM)); }
+  bool operator!= (const cSatipPid &objP) const { return !(*this == objP); }
+  // Writes the sorted pids not found in excludeP as a comma separated list and returns its length
+  int ListPids(char *bufferP, int sizeP, const cSatipPid *excludeP = NULL) const
+  {
+    int length = 0;
+    if (sizeP <= 0)
+       return 0;
+    *bufferP = 0;
+    for (int i = 0; i < eWords; ++i) {
+        uint64_t bits = excludeP ? (bitsM[i] & ~excludeP->bitsM[i]) : bitsM[i];
+        while (bits) {
+          int n = snprintf(bufferP + length, sizeP - length, "%s%d", length ? "," : "", i * eWordBits + __builtin_ctzll(bits));
+          if ((n < 0) || (n >= sizeP - length)) {
+             bufferP[length] = 0;
+             return length;
+             }
+          length += n;
+          bits &= bits - 1;
+          }
+        }
+    return length;
+  }
+  cString ListPids(void) const
+  {
+    char *buffer = MALLOC(char, eMaxListLength);
+    if (!buffer)
+       return "";
+    ListPids(buffer, eMaxListLength);
+    return cString(buffer, true);
   }
 };
 
@@ -70,6 +121,7 @@ public:
   bool IsValid(void) { return !!serverM; }
   bool IsQuirk(int quirkP) { return (serverM && cSatipDiscover::GetInstance()->IsServerQuirk(serverM, quirkP)); }
   bool HasCI(void) { return (serverM && cSatipDiscover::GetInstance()->HasServerCI(serverM)); }
+  int GetPidLimit(void) { return serverM ? cSatipDiscover::GetInstance()->GetServerPidLimit(serverM) : 0; }
   void Attach(void) { if (serverM) cSatipDiscover::GetInstance()->AttachServer(serverM, deviceIdM, transponderM); }
   void Detach(void) { if (serverM) cSatipDiscover::GetInstance()->DetachServer(serverM, deviceIdM, transponderM); }
   void Set(cSatipServer *serverP, const int transponderP) { serverM = serverP; transponderM = transponderP; }
@@ -77,12 +129,23 @@ public:
   cString GetAddress(void) { return serverM ? cSatipDiscover::GetInstance()->GetServerAddress(serverM) : ""; }
   cString GetSrcAddress(void) { return serverM ? cSatipDiscover::GetInstance()->GetSourceAddress(serverM) : ""; }
   int GetPort(void) { return serverM ? cSatipDiscover::GetInstance()->GetServerPort(serverM) : SATIP_DEFAULT_RTSP_PORT; }
+  void AddZapTime(uint64_t msP) { if (serverM) cSatipDiscover::GetInstance()->AddServerZapTime(serverM, msP); }
+  void AddSavedRequest(void) { if (serverM) cSatipDiscover::GetInstance()->AddServerSavedRequest(serverM); }
+  void AddError(void) { if (serverM) cSatipDiscover::GetInstance()->AddServerError(serverM); }
+  void AddSuccess(void) { if (serverM) cSatipDiscover::GetInstance()->AddServerSuccess(serverM); }
+  bool IsBlocked(void) { return (serverM && cSatipDiscover::GetInstance()->IsServerBlocked(serverM, deviceIdM)); }
+  bool Probe(void) { return (!serverM || cSatipDiscover::GetInstance()->ProbeServer(serverM, deviceIdM)); }
   cString GetInfo(void) { return cString::sprintf("server=%s deviceid=%d transponder=%d", serverM ? "assigned" : "null", deviceIdM, transponderM); }
 };
 
 class cSatipTuner : public cThread, public cSatipTunerStatistics, public cSatipTunerIf
 {
 private:
+  // Another device receiving its pids from this tuner's session
+  struct tSatipTunerShare {
+    cSatipDeviceIf *device;
+    cSatipPid pids;
+  };
   enum {
     eDummyPid                 = 100,
     eDefaultSignalStrengthDBm = -25,
@@ -90,15 +153,18 @@ private:
     eDefaultSignalQuality     = 15,
     eSleepTimeoutMs           = 250,   // in milliseconds
     eStatusUpdateTimeoutMs    = 1000,  // in milliseconds
-    ePidUpdateIntervalMs      = 250,   // in milliseconds
     eConnectTimeoutMs         = 5000,  // in milliseconds
     eIdleCheckTimeoutMs       = 15000, // in milliseconds
     eTuningTimeoutMs          = 20000, // in milliseconds
     eMinKeepAliveIntervalMs   = 30000, // in milliseconds
     eKeepAlivePreBufferMs     = 2000,  // in milliseconds
-    eSetupTimeoutMs           = 2000   // in milliseconds
+    eSetupTimeoutMs           = 2000,  // in milliseconds
+    eRtcpLockTimeoutMs        = 1000,  // in milliseconds
+    eRtcpStatusTimeoutMs      = 3000,  // in milliseconds
+    eFailoverIntervalMs       = 1000   // in milliseconds
   };
   enum eTunerState { tsIdle, tsRelease, tsSet, tsTuned, tsLocked };
+  enum eZapState { zsIdle, zsRequested, zsRunning, zsDone };
   enum eStateMode { smInternal, smExternal };
 
   cCondWait sleepM;
@@ -113,14 +179,26 @@ private:
   cString lastParamM;
   cString tnrParamM;
   int streamPortM;
+  bool multicastM;
   cSatipTunerServer currentServerM;
   cSatipTunerServer nextServerM;
   cMutex mutexM;
+  cMutex pidMutexM;
+  unsigned int sourceGenerationM;
   cTimeMs reConnectM;
   cTimeMs keepAliveM;
   cTimeMs statusUpdateM;
-  cTimeMs pidUpdateCacheM;
+  cTimeMs pidUpdateM;
   cTimeMs setupTimeoutM;
+  cTimeMs rtcpLockM;
+  cTimeMs rtcpStatusM;
+  std::atomic<uint64_t> zapStartM;
+  std::atomic<int> zapStateM;
+  std::atomic<uint64_t> zapTimeM;
+  cTimeMs failoverM;
+  std::atomic<uint64_t> lastDataMsM;
+  std::atomic<uint64_t> gapStartMsM;
+  bool pidsPlayedM;
   cString sessionM;
   eTunerState currentStateM;
   cVector<eTunerState> internalStateM;
@@ -133,23 +211,38 @@ private:
   int frontendIdM;
   int streamIdM;
   int pmtPidM;
-  cSatipPid addPidsM;
-  cSatipPid delPidsM;
+  cSatipPid ownPidsM;
   cSatipPid pidsM;
-  std::vector<std::string> TP;
+  cSatipPid sentPidsM;
+  tSatipTunerShare sharesM[SATIP_MAX_DEVICES];
+  std::atomic<int> shareCountM;
+  cSatipTuner *shareOwnerM;
+  bool allPidsM;
+  char pidQueryM[cSatipPid::eMaxListLength + 256];
+  char tpM[128];
+  size_t tpLengthM;
 
+  bool FastZap(void);
   bool Connect(void);
   bool Disconnect(void);
   bool Receive(void);
+  void StartZapTimer(void);
+  bool ProbeServer(void);
+  void Failover(void);
   bool KeepAlive(bool forceP = false);
   bool ReadReceptionStatus(bool forceP = false);
   bool UpdatePids(bool forceP = false);
+  bool PidsPending(int limitP);
+  void UpdatePidUnion(void);
+  void WritePids(cSatipDeviceIf &deviceP, const cSatipPid &pidsP, u_char *bufferP, int lengthP);
+  int SleepTimeout(void);
   void UpdateCurrentState(void);
   bool StateRequested(void);
   bool RequestState(eTunerState stateP, eStateMode modeP);
   const char *StateModeString(eStateMode modeP);
   const char *TunerStateString(eTunerState stateP);
   cString GetBaseUrl(const char *addressP, const int portP);
+  void ParseReceptionStatus(u_char *bufferP, int lengthP);
 
 protected:
   virtual void Action(void);
@@ -158,8 +251,17 @@ public:
   cSatipTuner(cSatipDevice& deviceP, unsigned int packetLenP);
   virtual ~cSatipTuner();
   bool IsTuned(void) const { return (currentStateM >= tsTuned); }
+  bool IsReleased(void);
+  bool Release(void);
   bool SetSource(cSatipServer *serverP, const int transponderP, const char *parameterP, const int indexP);
+  bool IsServerBlocked(void);
   bool SetPid(int pidP, int typeP, bool onP);
+  bool JoinShare(cSatipTuner *ownerP);
+  void LeaveShare(void);
+  bool AddShare(cSatipDeviceIf *deviceP, const cSatipPid &pidsP);
+  void RemoveShare(cSatipDeviceIf *deviceP);
+  bool SetSharePid(cSatipDeviceIf *deviceP, int pidP, bool onP);
+  int ShareCount(void) const { return shareCountM; }
   bool Open(void);
   bool Close(void);
   int FrontendId(void);
@@ -174,6 +276,7 @@ public:
 public:
   virtual void ProcessVideoData(u_char *bufferP, int lengthP);
   virtual void ProcessApplicationData(u_char *bufferP, int lengthP);
+  virtual void ProcessDescribeData(u_char *bufferP, int lengthP);
   virtual void ProcessRtpData(u_char *bufferP, int lengthP);
   virtual void ProcessRtcpData(u_char *bufferP, int lengthP);
   virtual void SetStreamId(int streamIdP);
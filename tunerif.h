@@ -14,6 +14,7 @@ public:
   virtual ~cSatipTunerIf() {}
   virtual void ProcessVideoData(u_char *bufferP, int lengthP) = 0;
   virtual void ProcessApplicationData(u_char *bufferP, int lengthP) = 0;
+  virtual void ProcessDescribeData(u_char *bufferP, int lengthP) = 0;
   virtual void ProcessRtpData(u_char *bufferP, int lengthP) = 0;
   virtual void ProcessRtcpData(u_char *bufferP, int lengthP) = 0;
   virtual void SetStreamId(int streamIdP) = 0;